@@ -0,0 +1,204 @@
+#include "adaptive.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <string_view>
+
+#include "charscan.h"
+#include "vowels.h"
+
+namespace charscan {
+
+// A window is long enough that one clock read per window is noise, and short
+// enough that a round of trials over a slow candidate stays cheap.
+static constexpr uint64_t kWindowStrings = 256;
+// During trials the clock is also read every kCheckStrings strings, so that a
+// candidate that has already taken longer than the best one's whole window is
+// cut off.
+static constexpr uint64_t kCheckStrings = 16;
+// Windows between trials. The interval doubles each time the trials keep the
+// same strategy and starts over when they change it or the input changes.
+static constexpr uint64_t kMinInterval = 16;
+static constexpr uint64_t kMaxInterval = 4096;
+// More than this much change in hit rate, or a factor of kLengthChange in
+// mean length, and the input counts as changed.
+static constexpr double kHitRateChange = 0.25;
+static constexpr double kLengthChange = 2;
+
+// The fast, usually best candidates come first, so that the cutoff above
+// applies to the slow ones.
+static constexpr VowelStrategy kSingleCandidates[] = {
+    VowelStrategy::kNibble,
+    VowelStrategy::kSimd,
+    VowelStrategy::kSwar,
+    VowelStrategy::kLoop,
+};
+static constexpr VowelStrategy kBatchCandidates[] = {
+    VowelStrategy::kBatch,
+    VowelStrategy::kNibble,
+    VowelStrategy::kSimd,
+    VowelStrategy::kSwar,
+    VowelStrategy::kLoop,
+};
+
+std::string_view VowelStrategyName(VowelStrategy strategy) {
+  switch (strategy) {
+    case VowelStrategy::kLoop:
+      return "Loop";
+    case VowelStrategy::kSwar:
+      return "Swar";
+    case VowelStrategy::kSimd:
+      return "Simd";
+    case VowelStrategy::kNibble:
+      return "Nibble";
+    case VowelStrategy::kBatch:
+      return "Batch";
+  }
+  return "?";
+}
+
+static bool HasVowelWith(VowelStrategy strategy, std::string_view haystack) {
+  switch (strategy) {
+    case VowelStrategy::kLoop:
+      return HasVowelLoopInterchanged(haystack);
+    case VowelStrategy::kSwar:
+      return HasVowelSwar(haystack);
+    case VowelStrategy::kSimd:
+      return HasVowelSimd(haystack);
+    case VowelStrategy::kNibble:
+    case VowelStrategy::kBatch:
+      break;
+  }
+  return HasAnyOfNibble(haystack, kVowelNibbleTables);
+}
+
+AdaptiveVowelMatcher::Selector::Selector(
+    std::span<const VowelStrategy> candidates)
+    : candidates_(candidates),
+      strategy_(candidates.front()),
+      start_(Clock::now()),
+      next_check_(kCheckStrings),
+      previous_(candidates.front()),
+      best_window_ns_(std::numeric_limits<double>::infinity()),
+      interval_(kMinInterval) {}
+
+void AdaptiveVowelMatcher::Selector::Record(size_t strings, size_t bytes,
+                                            size_t hits, Stats& stats) {
+  stats.strings[static_cast<size_t>(strategy_)] += strings;
+  strings_ += strings;
+  bytes_ += bytes;
+  hits_ += hits;
+  if (strings_ >= kWindowStrings) {
+    EndWindow(Clock::now(), stats);
+  } else if (trial_ >= 0 && strings_ >= next_check_) {
+    next_check_ = strings_ + kCheckStrings;
+    const Clock::time_point now = Clock::now();
+    if (std::chrono::duration<double, std::nano>(now - start_).count() >
+        best_window_ns_) {
+      EndWindow(now, stats);
+    }
+  }
+}
+
+bool AdaptiveVowelMatcher::Selector::InputChanged(double length,
+                                                  double hit_rate) const {
+  // Plus one, so that a corpus of empty strings has a ratio too.
+  const double ratio = (length + 1) / (chosen_length_ + 1);
+  return ratio > kLengthChange || ratio < 1 / kLengthChange ||
+         std::abs(hit_rate - chosen_hit_rate_) > kHitRateChange;
+}
+
+void AdaptiveVowelMatcher::Selector::EndWindow(Clock::time_point now,
+                                               Stats& stats) {
+  const double ns =
+      std::chrono::duration<double, std::nano>(now - start_).count();
+  const double length = static_cast<double>(bytes_) / strings_;
+  const double hit_rate = static_cast<double>(hits_) / strings_;
+
+  if (trial_ >= 0) {
+    // Per string, since a candidate that was cut off saw fewer of them.
+    cost_[static_cast<size_t>(strategy_)] = ns / strings_;
+    best_window_ns_ = std::min(best_window_ns_, ns / strings_ * kWindowStrings);
+    trial_strings_ += strings_;
+    trial_bytes_ += bytes_;
+    trial_hits_ += hits_;
+    if (++trial_ < static_cast<int>(candidates_.size())) {
+      strategy_ = candidates_[trial_];
+    } else {
+      strategy_ = *std::min_element(
+          candidates_.begin(), candidates_.end(),
+          [&](VowelStrategy a, VowelStrategy b) {
+            return cost_[static_cast<size_t>(a)] <
+                   cost_[static_cast<size_t>(b)];
+          });
+      ++stats.trials;
+      if (strategy_ != previous_) {
+        ++stats.switches;
+        interval_ = kMinInterval;
+      } else {
+        interval_ = std::min(2 * interval_, kMaxInterval);
+      }
+      trial_ = -1;
+      windows_left_ = interval_;
+      chosen_length_ = static_cast<double>(trial_bytes_) / trial_strings_;
+      chosen_hit_rate_ = static_cast<double>(trial_hits_) / trial_strings_;
+    }
+  } else {
+    const bool changed = InputChanged(length, hit_rate);
+    if (changed) {
+      interval_ = kMinInterval;
+    }
+    if (changed || --windows_left_ == 0) {
+      trial_ = 0;
+      previous_ = strategy_;
+      strategy_ = candidates_[0];
+      best_window_ns_ = std::numeric_limits<double>::infinity();
+      trial_strings_ = trial_bytes_ = trial_hits_ = 0;
+    }
+  }
+
+  start_ = now;
+  strings_ = bytes_ = hits_ = 0;
+  next_check_ = kCheckStrings;
+}
+
+AdaptiveVowelMatcher::AdaptiveVowelMatcher()
+    : single_(kSingleCandidates), batch_(kBatchCandidates) {}
+
+bool AdaptiveVowelMatcher::HasVowel(std::string_view haystack) {
+  const bool hit = HasVowelWith(single_.strategy(), haystack);
+  single_.Record(1, haystack.size(), hit, stats_);
+  return hit;
+}
+
+void AdaptiveVowelMatcher::HasVowelBatch(
+    std::span<const std::string_view> haystacks, std::span<uint64_t> bits) {
+  const VowelStrategy strategy = batch_.strategy();
+  size_t bytes = 0;
+  size_t hits = 0;
+  if (strategy == VowelStrategy::kBatch) {
+    charscan::HasVowelBatch(haystacks, bits);
+    for (size_t w = 0; w < BitVectorWords(haystacks.size()); ++w) {
+      hits += __builtin_popcountll(bits[w]);
+    }
+    for (std::string_view haystack : haystacks) {
+      bytes += haystack.size();
+    }
+  } else {
+    std::fill(bits.begin(), bits.begin() + BitVectorWords(haystacks.size()), 0);
+    for (size_t i = 0; i < haystacks.size(); ++i) {
+      const bool hit = HasVowelWith(strategy, haystacks[i]);
+      bits[i / 64] |= uint64_t{hit} << (i % 64);
+      bytes += haystacks[i].size();
+      hits += hit;
+    }
+  }
+  batch_.Record(haystacks.size(), bytes, hits, stats_);
+}
+
+}  // namespace charscan
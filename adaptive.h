@@ -0,0 +1,122 @@
+// A HasVowel that picks its kernel from how the kernels perform on the input
+// it is actually given.
+//
+// The best kernel depends on the strings: the early-exit loop wins when a
+// vowel comes within the first few bytes, the vector kernels on long strings
+// without one, and the batch kernel on bursts of tiny strings. Where the
+// crossovers are depends on the CPU too, so rather than hard-code thresholds,
+// the matcher times each candidate on a window of the input and keeps the
+// fastest. It watches the mean length and hit rate of the strings and runs
+// the trials again when either moves, and also, ever less often while the
+// answer doesn't change, in case the input changed in a way those miss.
+
+#ifndef ADAPTIVE_H_
+#define ADAPTIVE_H_
+
+#include <array>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+namespace charscan {
+
+enum class VowelStrategy {
+  kLoop,    // HasVowelLoopInterchanged
+  kSwar,    // HasVowelSwar
+  kSimd,    // HasVowelSimd
+  kNibble,  // HasAnyOfNibble
+  kBatch,   // HasVowelBatch; only for AdaptiveVowelMatcher::HasVowelBatch
+};
+inline constexpr size_t kNumVowelStrategies = 5;
+
+std::string_view VowelStrategyName(VowelStrategy strategy);
+
+// Not thread-safe: each thread should have its own, which also lets it adapt
+// to that thread's input.
+class AdaptiveVowelMatcher {
+ public:
+  // What the matcher has decided so far.
+  struct Stats {
+    // How many strings each strategy answered, trials included.
+    std::array<uint64_t, kNumVowelStrategies> strings = {};
+    // Completed rounds of trials, and how many of them changed the strategy.
+    uint64_t trials = 0;
+    uint64_t switches = 0;
+  };
+
+  AdaptiveVowelMatcher();
+
+  bool HasVowel(std::string_view haystack);
+
+  // Same contract as charscan::HasVowelBatch. Batches are timed separately
+  // from single strings and can also be answered by the batch kernel.
+  void HasVowelBatch(std::span<const std::string_view> haystacks,
+                     std::span<uint64_t> bits);
+
+  // The strategies currently in use.
+  VowelStrategy strategy() const { return single_.strategy(); }
+  VowelStrategy batch_strategy() const { return batch_.strategy(); }
+
+  const Stats& stats() const { return stats_; }
+
+ private:
+  // Chooses among candidates, as described at the top of this file. Windows
+  // are counted in strings, so a window of batches ends at the first batch
+  // that fills it.
+  class Selector {
+   public:
+    explicit Selector(std::span<const VowelStrategy> candidates);
+
+    VowelStrategy strategy() const { return strategy_; }
+
+    // Records that the current strategy just answered `strings` strings of
+    // `bytes` bytes in total, `hits` of which had a vowel. This may change
+    // the strategy.
+    void Record(size_t strings, size_t bytes, size_t hits, Stats& stats);
+
+   private:
+    using Clock = std::chrono::steady_clock;
+
+    void EndWindow(Clock::time_point now, Stats& stats);
+    bool InputChanged(double length, double hit_rate) const;
+
+    std::span<const VowelStrategy> candidates_;
+    VowelStrategy strategy_;
+
+    // The current window.
+    Clock::time_point start_;
+    uint64_t strings_ = 0;
+    uint64_t bytes_ = 0;
+    uint64_t hits_ = 0;
+    uint64_t next_check_ = 0;
+
+    // During trials, the index in candidates_ of the one being timed, the
+    // strategy before the trials, and the time per string of the candidates
+    // timed so far; otherwise trial_ is -1.
+    int trial_ = 0;
+    VowelStrategy previous_;
+    std::array<double, kNumVowelStrategies> cost_ = {};
+    double best_window_ns_ = 0;
+    // What the trial windows saw, summed.
+    uint64_t trial_strings_ = 0;
+    uint64_t trial_bytes_ = 0;
+    uint64_t trial_hits_ = 0;
+
+    // The input the strategy was chosen for, and the windows left until the
+    // next trials.
+    double chosen_length_ = 0;
+    double chosen_hit_rate_ = 0;
+    uint64_t windows_left_ = 0;
+    uint64_t interval_ = 0;
+  };
+
+  Stats stats_;
+  Selector single_;
+  Selector batch_;
+};
+
+}  // namespace charscan
+
+#endif  // ADAPTIVE_H_
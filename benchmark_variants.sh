@@ -0,0 +1,75 @@
+#!/bin/bash
+# Runs vowels-benchmark_test once per build variant and prints the results side
+# by side: the time of the default build, and each variant's speedup over it.
+#
+#   default       -c opt, the portable binary we ship
+#   multiversion  target_clones of the portable kernels (see vowels.h)
+#   native        -march=native
+#   thinlto       ThinLTO
+#   pgo           ThinLTO with a profile recorded by an instrumented run of
+#                 the same benchmarks
+#
+# The variants are .bazelrc configs. Usage:
+#
+#   ./benchmark_variants.sh [benchmark filter regex], e.g.
+#   ./benchmark_variants.sh 'BM_HasVowel(Loop|Swar|Simd)_'
+
+set -euo pipefail
+
+filter=${1:-BM_HasVowel}
+profile_dir=/tmp/charscan-pgo
+llvm_profdata=${LLVM_PROFDATA:-llvm-profdata-18}
+results=$(mktemp -d)
+
+run() {
+  local variant=$1
+  shift
+  echo "== $variant" >&2
+  bazel run -c opt "$@" :vowels-benchmark_test -- \
+    --benchmark_filter="$filter" --benchmark_perf_counters= \
+    --benchmark_format=csv >"$results/$variant.csv"
+}
+
+run default
+run multiversion --config=multiversion
+run native --config=native
+run thinlto --config=thinlto
+
+# The training run is the benchmark itself, on the same corpora it is then
+# measured on, so this is the best case for PGO.
+rm -rf "$profile_dir"
+run pgo_training --config=pgo_instrument
+"$llvm_profdata" merge -output="$profile_dir/merged.profdata" \
+  "$profile_dir"/*.profraw
+run pgo --config=pgo
+
+awk -F, -v variants="default multiversion native thinlto pgo" '
+  BEGIN { num_variants = split(variants, variant, " ") }
+  FNR == 1 {
+    file = FILENAME
+    sub(/.*\//, "", file)
+    sub(/\.csv$/, "", file)
+  }
+  $1 ~ /^"/ && $3 != "" {
+    name = $1
+    gsub(/"/, "", name)
+    if (!(name in unit)) order[++num_names] = name
+    time[name, file] = $3
+    unit[name] = $5
+  }
+  END {
+    printf "%-64s %14s", "Benchmark", "default"
+    for (v = 2; v <= num_variants; ++v) printf " %12s", variant[v]
+    printf "\n"
+    for (i = 1; i <= num_names; ++i) {
+      name = order[i]
+      base = time[name, "default"]
+      printf "%-64s %11.0f %-2s", name, base, unit[name]
+      for (v = 2; v <= num_variants; ++v) {
+        t = time[name, variant[v]]
+        if (t > 0) printf " %11.2fx", base / t
+        else printf " %12s", "-"
+      }
+      printf "\n"
+    }
+  }' "$results"/*.csv
@@ -0,0 +1,54 @@
+// What the benchmark harness itself costs, so that it can be told apart from
+// what the kernels cost. On the short-string datasets a kernel call is a few
+// nanoseconds, and the loop around it is a large part of every measurement.
+//
+// main-benchmark_test measures each part of the harness on its own:
+// BM_EmptyLoop, BM_Noop, BM_RangeFor, BM_DirectCall and BM_IndirectCall.
+// vowels-benchmark_test subtracts HarnessNsPerString from its kernels.
+
+#ifndef CALIBRATION_H_
+#define CALIBRATION_H_
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string_view>
+
+#include "benchmark/benchmark.h"
+
+namespace charscan {
+
+// A kernel that does nothing but take its argument, compiled out of line like
+// the real ones, so that calling it costs what calling them does.
+bool NoopKernel(std::string_view haystack);
+
+// The time per string, in ns, of the loop BENCHMARK_HAS_VOWEL runs with
+// NoopKernel as the kernel: the range-for over `strs`, the call, and
+// DoNotOptimize. Measured on `strs` itself, since the loop's cost depends on
+// how the strings are laid out. The fastest of five runs of at least 2 ms
+// each, because noise only ever adds time.
+template <typename Strings>
+double HarnessNsPerString(const Strings& strs) {
+  if (std::size(strs) == 0) return 0;
+  using Clock = std::chrono::steady_clock;
+  double fastest = std::numeric_limits<double>::infinity();
+  for (int run = 0; run < 5; ++run) {
+    uint64_t passes = 0;
+    const Clock::time_point start = Clock::now();
+    Clock::duration elapsed;
+    do {
+      for (std::string_view s : strs) benchmark::DoNotOptimize(NoopKernel(s));
+      ++passes;
+      elapsed = Clock::now() - start;
+    } while (elapsed < std::chrono::milliseconds(2));
+    const std::chrono::duration<double, std::nano> ns = elapsed;
+    fastest = std::min(fastest, ns.count() / (passes * std::size(strs)));
+  }
+  return fastest;
+}
+
+}  // namespace charscan
+
+#endif  // CALIBRATION_H_
@@ -0,0 +1,1092 @@
+#include "charscan.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <future>
+#include <span>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+#include "pipeline.h"
+
+namespace charscan {
+
+// __builtin_cpu_init() is required when these are called from a static
+// initializer, before libgcc/compiler-rt has had a chance to run its own
+// constructor.
+bool CpuHasSsse3() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("ssse3");
+#else
+  return false;
+#endif
+}
+
+bool CpuHasAvx2() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx2");
+#else
+  return false;
+#endif
+}
+
+bool CpuHasAvx512Bw() {
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_cpu_init();
+  return __builtin_cpu_supports("avx512bw");
+#else
+  return false;
+#endif
+}
+
+bool HasAnyOfNibbleScalar(std::string_view haystack,
+                          const NibbleTables& tables) {
+  for (char c : haystack) {
+    auto b = static_cast<uint8_t>(c);
+    if ((tables.lo[b & 0xf] & tables.hi[b >> 4]) != 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Returns a mask with bit i set iff lane i of chunk is in the set.
+__attribute__((target("ssse3"))) static inline uint32_t SetMaskSsse3(
+    __m128i chunk, __m128i lo, __m128i hi) {
+  const __m128i nibble = _mm_set1_epi8(0x0f);
+  // There is no 8-bit shift; the bits shifted in from the neighbouring byte
+  // are masked off.
+  __m128i lo_class = _mm_shuffle_epi8(lo, _mm_and_si128(chunk, nibble));
+  __m128i hi_class =
+      _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble));
+  __m128i zero = _mm_cmpeq_epi8(_mm_and_si128(lo_class, hi_class),
+                                _mm_setzero_si128());
+  return ~_mm_movemask_epi8(zero) & 0xffff;
+}
+
+__attribute__((target("ssse3"))) static inline bool AnyInSetSsse3(
+    __m128i chunk, __m128i lo, __m128i hi) {
+  return SetMaskSsse3(chunk, lo, hi) != 0;
+}
+
+__attribute__((target("ssse3"))) bool HasAnyOfNibbleSsse3(
+    std::string_view haystack, const NibbleTables& tables) {
+  static constexpr size_t kWidth = sizeof(__m128i);
+  if (haystack.size() < kWidth) {
+    return HasAnyOfNibbleScalar(haystack, tables);
+  }
+
+  const __m128i lo = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.lo.data()));
+  const __m128i hi = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.hi.data()));
+  const char* data = haystack.data();
+  const char* last = data + haystack.size() - kWidth;
+  for (; data < last; data += kWidth) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    if (AnyInSetSsse3(chunk, lo, hi)) {
+      return true;
+    }
+  }
+  __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last));
+  return AnyInSetSsse3(chunk, lo, hi);
+}
+
+__attribute__((target("avx2"))) static inline uint32_t SetMaskAvx2(
+    __m256i chunk, __m256i lo, __m256i hi) {
+  const __m256i nibble = _mm256_set1_epi8(0x0f);
+  __m256i lo_class = _mm256_shuffle_epi8(lo, _mm256_and_si256(chunk, nibble));
+  __m256i hi_class = _mm256_shuffle_epi8(
+      hi, _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble));
+  __m256i zero = _mm256_cmpeq_epi8(_mm256_and_si256(lo_class, hi_class),
+                                   _mm256_setzero_si256());
+  return ~static_cast<uint32_t>(_mm256_movemask_epi8(zero));
+}
+
+__attribute__((target("avx2"))) static inline bool AnyInSetAvx2(
+    __m256i chunk, __m256i lo, __m256i hi) {
+  return SetMaskAvx2(chunk, lo, hi) != 0;
+}
+
+__attribute__((target("avx2"))) bool HasAnyOfNibbleAvx2(
+    std::string_view haystack, const NibbleTables& tables) {
+  static constexpr size_t kWidth = sizeof(__m256i);
+  if (haystack.size() < kWidth) {
+    return HasAnyOfNibbleSsse3(haystack, tables);
+  }
+
+  // vpshufb shuffles within each 128-bit lane, so both lanes get a copy of
+  // the tables.
+  const __m256i lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.lo.data())));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.hi.data())));
+  const char* data = haystack.data();
+  const char* last = data + haystack.size() - kWidth;
+  for (; data < last; data += kWidth) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    if (AnyInSetAvx2(chunk, lo, hi)) {
+      return true;
+    }
+  }
+  __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last));
+  return AnyInSetAvx2(chunk, lo, hi);
+}
+#endif
+
+#if defined(__aarch64__)
+// Returns a vector whose lane i is non-zero iff lane i of chunk is in the set.
+static inline uint8x16_t ClassifyNeon(uint8x16_t chunk, uint8x16_t lo,
+                                      uint8x16_t hi) {
+  uint8x16_t lo_class = vqtbl1q_u8(lo, vandq_u8(chunk, vdupq_n_u8(0x0f)));
+  uint8x16_t hi_class = vqtbl1q_u8(hi, vshrq_n_u8(chunk, 4));
+  return vandq_u8(lo_class, hi_class);
+}
+
+static inline bool AnyInSetNeon(uint8x16_t chunk, uint8x16_t lo,
+                                uint8x16_t hi) {
+  return vmaxvq_u8(ClassifyNeon(chunk, lo, hi)) != 0;
+}
+
+bool HasAnyOfNibbleNeon(std::string_view haystack,
+                        const NibbleTables& tables) {
+  static constexpr size_t kWidth = sizeof(uint8x16_t);
+  if (haystack.size() < kWidth) {
+    return HasAnyOfNibbleScalar(haystack, tables);
+  }
+
+  const uint8x16_t lo = vld1q_u8(tables.lo.data());
+  const uint8x16_t hi = vld1q_u8(tables.hi.data());
+  const auto* data = reinterpret_cast<const uint8_t*>(haystack.data());
+  const auto* last = data + haystack.size() - kWidth;
+  for (; data < last; data += kWidth) {
+    if (AnyInSetNeon(vld1q_u8(data), lo, hi)) {
+      return true;
+    }
+  }
+  return AnyInSetNeon(vld1q_u8(last), lo, hi);
+}
+#endif
+
+static constexpr size_t kPageSize = 4096;
+static constexpr size_t kPrefix = 16;
+static bool PrefixLoadStaysInPage(const char* data) {
+  return (reinterpret_cast<uintptr_t>(data) & (kPageSize - 1)) <=
+         kPageSize - kPrefix;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// Sets *valid to the lanes of the returned vector that hold the first
+// min(size, kPrefix) bytes of data.
+static inline __m128i LoadPrefixSse2(std::string_view haystack,
+                                     uint32_t* valid) {
+  if (haystack.empty()) {
+    *valid = 0;
+    return _mm_setzero_si128();
+  }
+  if (haystack.size() >= kPrefix) {
+    *valid = 0xffff;
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack.data()));
+  }
+  *valid = (1u << haystack.size()) - 1;
+  if (PrefixLoadStaysInPage(haystack.data())) {
+    return _mm_loadu_si128(reinterpret_cast<const __m128i*>(haystack.data()));
+  }
+  *valid <<= kPrefix - haystack.size();
+  return _mm_loadu_si128(reinterpret_cast<const __m128i*>(
+      haystack.data() + haystack.size() - kPrefix));
+}
+
+#endif
+
+#if defined(__aarch64__)
+// kLaneMask + 16 - n is a vector whose first n lanes are set; kLaneMask + 16
+// + n is one whose last 16 - n lanes are set.
+alignas(16) static constexpr uint8_t kLaneMask[48] = {
+    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,
+    0,    0,    0,    0,    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+    0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0,    0,    0,    0,
+    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0,    0};
+
+// Like LoadPrefixSse2, but the valid lanes are returned as a vector mask.
+static inline uint8x16_t LoadPrefixNeon(std::string_view haystack,
+                                        uint8x16_t* valid) {
+  const auto* data = reinterpret_cast<const uint8_t*>(haystack.data());
+  if (haystack.empty()) {
+    *valid = vdupq_n_u8(0);
+    return vdupq_n_u8(0);
+  }
+  if (haystack.size() >= kPrefix) {
+    *valid = vdupq_n_u8(0xff);
+    return vld1q_u8(data);
+  }
+  if (PrefixLoadStaysInPage(haystack.data())) {
+    *valid = vld1q_u8(kLaneMask + kPrefix - haystack.size());
+    return vld1q_u8(data);
+  }
+  *valid = vld1q_u8(kLaneMask + kPrefix + haystack.size());
+  return vld1q_u8(data + haystack.size() - kPrefix);
+}
+
+#endif
+
+// The short kernels read each haystack with one to four vector loads and no
+// loop. Up to kPrefix bytes, that is a single page-safe load (see the batch
+// queries in charscan.h); beyond that, the first and last vectors of the
+// haystack, plus the vectors next to them if those two don't cover it, all of
+// which lie within the haystack. Lanes covered twice are simply tested twice.
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3"))) bool HasAnyOfNibbleShortSsse3(
+    std::string_view haystack, const NibbleTables& tables) {
+  const __m128i lo = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.lo.data()));
+  const __m128i hi = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.hi.data()));
+  const char* data = haystack.data();
+  const size_t size = haystack.size();
+  if (size <= kPrefix) {
+    uint32_t valid;
+    __m128i prefix = LoadPrefixSse2(haystack, &valid);
+    return (SetMaskSsse3(prefix, lo, hi) & valid) != 0;
+  }
+  auto mask_at = [&](const char* p) {
+    return SetMaskSsse3(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)),
+                        lo, hi);
+  };
+  uint32_t mask = mask_at(data) | mask_at(data + size - kPrefix);
+  if (size > 2 * kPrefix) {
+    mask |= mask_at(data + kPrefix) | mask_at(data + size - 2 * kPrefix);
+  }
+  return mask != 0;
+}
+
+__attribute__((target("avx2"))) bool HasAnyOfNibbleShortAvx2(
+    std::string_view haystack, const NibbleTables& tables) {
+  const char* data = haystack.data();
+  const size_t size = haystack.size();
+  if (size <= kPrefix) {
+    return HasAnyOfNibbleShortSsse3(haystack, tables);
+  }
+  const __m256i lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.lo.data())));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.hi.data())));
+  if (size <= 2 * kPrefix) {
+    // The first and last 16 bytes, in the two halves of one register.
+    __m256i chunk = _mm256_loadu2_m128i(
+        reinterpret_cast<const __m128i*>(data + size - kPrefix),
+        reinterpret_cast<const __m128i*>(data));
+    return SetMaskAvx2(chunk, lo, hi) != 0;
+  }
+  __m256i head = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+  __m256i tail = _mm256_loadu_si256(
+      reinterpret_cast<const __m256i*>(data + size - sizeof(__m256i)));
+  return (SetMaskAvx2(head, lo, hi) | SetMaskAvx2(tail, lo, hi)) != 0;
+}
+
+// A masked load never faults on the lanes it leaves out, so with AVX-512 every
+// short haystack is a single load, wherever it is in its page.
+__attribute__((target("avx512f,avx512bw"))) bool HasAnyOfNibbleShortAvx512(
+    std::string_view haystack, const NibbleTables& tables) {
+  const __m512i lo = _mm512_broadcast_i32x4(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.lo.data())));
+  const __m512i hi = _mm512_broadcast_i32x4(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.hi.data())));
+  const __mmask64 valid = haystack.size() >= kShortHaystack
+                              ? ~uint64_t{0}
+                              : (uint64_t{1} << haystack.size()) - 1;
+  const __m512i chunk = _mm512_maskz_loadu_epi8(valid, haystack.data());
+  const __m512i nibble = _mm512_set1_epi8(0x0f);
+  __m512i lo_class = _mm512_shuffle_epi8(lo, _mm512_and_si512(chunk, nibble));
+  __m512i hi_class = _mm512_shuffle_epi8(
+      hi, _mm512_and_si512(_mm512_srli_epi16(chunk, 4), nibble));
+  // The zeroed lanes would match if the set contains '\0'.
+  return _mm512_mask_test_epi8_mask(valid, lo_class, hi_class) != 0;
+}
+#endif
+
+#if defined(__aarch64__)
+bool HasAnyOfNibbleShortNeon(std::string_view haystack,
+                             const NibbleTables& tables) {
+  const uint8x16_t lo = vld1q_u8(tables.lo.data());
+  const uint8x16_t hi = vld1q_u8(tables.hi.data());
+  const auto* data = reinterpret_cast<const uint8_t*>(haystack.data());
+  const size_t size = haystack.size();
+  if (size <= kPrefix) {
+    uint8x16_t valid;
+    uint8x16_t prefix = LoadPrefixNeon(haystack, &valid);
+    return vmaxvq_u8(vandq_u8(ClassifyNeon(prefix, lo, hi), valid)) != 0;
+  }
+  uint8x16_t hits = vorrq_u8(ClassifyNeon(vld1q_u8(data), lo, hi),
+                             ClassifyNeon(vld1q_u8(data + size - kPrefix), lo,
+                                          hi));
+  if (size > 2 * kPrefix) {
+    hits = vorrq_u8(hits, ClassifyNeon(vld1q_u8(data + kPrefix), lo, hi));
+    hits = vorrq_u8(
+        hits, ClassifyNeon(vld1q_u8(data + size - 2 * kPrefix), lo, hi));
+  }
+  return vmaxvq_u8(hits) != 0;
+}
+#endif
+
+using HasAnyOfFn = bool (*)(std::string_view, const NibbleTables&);
+
+static HasAnyOfFn SelectHasAnyOfNibble() {
+#if defined(__x86_64__) || defined(__i386__)
+  if (CpuHasAvx2()) {
+    return HasAnyOfNibbleAvx2;
+  }
+  if (CpuHasSsse3()) {
+    return HasAnyOfNibbleSsse3;
+  }
+  return HasAnyOfNibbleScalar;
+#elif defined(__aarch64__)
+  return HasAnyOfNibbleNeon;
+#else
+  return HasAnyOfNibbleScalar;
+#endif
+}
+
+static HasAnyOfFn SelectHasAnyOfNibbleShort() {
+#if defined(__x86_64__) || defined(__i386__)
+  if (CpuHasAvx512Bw()) {
+    return HasAnyOfNibbleShortAvx512;
+  }
+  if (CpuHasAvx2()) {
+    return HasAnyOfNibbleShortAvx2;
+  }
+  if (CpuHasSsse3()) {
+    return HasAnyOfNibbleShortSsse3;
+  }
+  return HasAnyOfNibbleScalar;
+#elif defined(__aarch64__)
+  return HasAnyOfNibbleShortNeon;
+#else
+  return HasAnyOfNibbleScalar;
+#endif
+}
+
+static const HasAnyOfFn kHasAnyOfNibble = SelectHasAnyOfNibble();
+static const HasAnyOfFn kHasAnyOfNibbleShort = SelectHasAnyOfNibbleShort();
+
+bool HasAnyOfNibble(std::string_view haystack, const NibbleTables& tables) {
+  if (haystack.size() <= kShortHaystack) {
+    return kHasAnyOfNibbleShort(haystack, tables);
+  }
+  return kHasAnyOfNibble(haystack, tables);
+}
+
+// The workers of HasAnyOfNibbleParallel, one per core besides the caller's,
+// started on first use. The tasks never block, so concurrent calls that
+// share the pool cannot deadlock.
+static ThreadPool& ParallelPool() {
+  static ThreadPool pool(
+      std::max(1, static_cast<int>(std::thread::hardware_concurrency()) - 1));
+  return pool;
+}
+
+bool HasAnyOfNibbleParallel(std::string_view haystack,
+                            const NibbleTables& tables, int num_threads) {
+  const size_t num_blocks =
+      (haystack.size() + kParallelBlockSize - 1) / kParallelBlockSize;
+  num_threads = std::min<size_t>(std::max(num_threads, 1), num_blocks);
+  if (num_threads <= 1) {
+    return HasAnyOfNibble(haystack, tables);
+  }
+
+  // Each thread starts on its own contiguous share of the blocks, and steals
+  // from the other shares once its own runs out. The owner and the thieves
+  // all take blocks by advancing the share's cursor, so taking a block is a
+  // single fetch_add. Shares are on separate cache lines so that the owners
+  // don't contend.
+  struct alignas(64) Share {
+    std::atomic<size_t> next;
+    size_t end;
+  };
+  std::vector<Share> shares(num_threads);
+  for (int i = 0; i < num_threads; ++i) {
+    shares[i].next = num_blocks * i / num_threads;
+    shares[i].end = num_blocks * (i + 1) / num_threads;
+  }
+
+  // Only a hint to stop early, so relaxed ordering is enough; waiting for the
+  // tasks publishes the final value.
+  std::atomic<bool> found = false;
+  auto work = [&](int self) {
+    for (int k = 0; k < num_threads; ++k) {
+      Share& share = shares[(self + k) % num_threads];
+      for (size_t block;
+           !found.load(std::memory_order_relaxed) &&
+           (block = share.next.fetch_add(1, std::memory_order_relaxed)) <
+               share.end;) {
+        if (HasAnyOfNibble(
+                haystack.substr(block * kParallelBlockSize, kParallelBlockSize),
+                tables)) {
+          found.store(true, std::memory_order_relaxed);
+        }
+      }
+    }
+  };
+
+  // The calling thread is one of the num_threads. The others come from a pool
+  // that outlives the call, so what the call costs on top of the scan is a
+  // task handoff per thread rather than a thread creation. A share whose task
+  // waits in the queue, e.g. with more threads than cores, is stolen by the
+  // running ones.
+  std::vector<std::future<void>> tasks;
+  for (int i = 1; i < num_threads; ++i) {
+    tasks.push_back(ParallelPool().Submit([&work, i] { work(i); }));
+  }
+  work(0);
+  for (std::future<void>& task : tasks) {
+    task.wait();
+  }
+  return found.load(std::memory_order_relaxed);
+}
+
+// The ASCII prefix is found a 64-byte block at a time, from the OR of its
+// vectors, then to the byte within the block that ends it. A haystack of
+// fewer than 64 bytes left over goes 16 (or 8) bytes at a time.
+static size_t AsciiPrefixTail(std::string_view haystack, size_t pos) {
+  static constexpr uint64_t kHighBits = 0x8080808080808080;
+  for (; pos + sizeof(uint64_t) <= haystack.size(); pos += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, haystack.data() + pos, sizeof(word));
+    if ((word & kHighBits) != 0) {
+      return pos + __builtin_ctzll(word & kHighBits) / 8;
+    }
+  }
+  for (; pos < haystack.size(); ++pos) {
+    if (static_cast<uint8_t>(haystack[pos]) >= 0x80) {
+      break;
+    }
+  }
+  return pos;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+// SSE2 is part of x86-64, so this needs no target attribute or CPU check.
+static size_t AsciiPrefixSse2(std::string_view haystack) {
+  const char* data = haystack.data();
+  size_t pos = 0;
+  for (; pos + 64 <= haystack.size(); pos += 64) {
+    const auto* block = reinterpret_cast<const __m128i*>(data + pos);
+    const __m128i v0 = _mm_loadu_si128(block);
+    const __m128i v1 = _mm_loadu_si128(block + 1);
+    const __m128i v2 = _mm_loadu_si128(block + 2);
+    const __m128i v3 = _mm_loadu_si128(block + 3);
+    if (_mm_movemask_epi8(_mm_or_si128(_mm_or_si128(v0, v1),
+                                       _mm_or_si128(v2, v3))) != 0) {
+      const uint64_t mask = static_cast<uint64_t>(_mm_movemask_epi8(v0)) |
+                            static_cast<uint64_t>(_mm_movemask_epi8(v1)) << 16 |
+                            static_cast<uint64_t>(_mm_movemask_epi8(v2)) << 32 |
+                            static_cast<uint64_t>(_mm_movemask_epi8(v3)) << 48;
+      return pos + __builtin_ctzll(mask);
+    }
+  }
+  for (; pos + 16 <= haystack.size(); pos += 16) {
+    const int mask = _mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)));
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+  return AsciiPrefixTail(haystack, pos);
+}
+
+__attribute__((target("avx2"))) static size_t AsciiPrefixAvx2(
+    std::string_view haystack) {
+  const char* data = haystack.data();
+  size_t pos = 0;
+  for (; pos + 64 <= haystack.size(); pos += 64) {
+    const auto* block = reinterpret_cast<const __m256i*>(data + pos);
+    const __m256i v0 = _mm256_loadu_si256(block);
+    const __m256i v1 = _mm256_loadu_si256(block + 1);
+    if (_mm256_movemask_epi8(_mm256_or_si256(v0, v1)) != 0) {
+      const uint64_t mask =
+          static_cast<uint32_t>(_mm256_movemask_epi8(v0)) |
+          static_cast<uint64_t>(static_cast<uint32_t>(_mm256_movemask_epi8(v1)))
+              << 32;
+      return pos + __builtin_ctzll(mask);
+    }
+  }
+  for (; pos + 16 <= haystack.size(); pos += 16) {
+    const int mask = _mm_movemask_epi8(
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos)));
+    if (mask != 0) {
+      return pos + __builtin_ctz(mask);
+    }
+  }
+  return AsciiPrefixTail(haystack, pos);
+}
+#elif defined(__aarch64__)
+static size_t AsciiPrefixNeon(std::string_view haystack) {
+  const auto* data = reinterpret_cast<const uint8_t*>(haystack.data());
+  size_t pos = 0;
+  for (; pos + 64 <= haystack.size(); pos += 64) {
+    const uint8_t* block = data + pos;
+    const uint8x16_t any =
+        vorrq_u8(vorrq_u8(vld1q_u8(block), vld1q_u8(block + 16)),
+                 vorrq_u8(vld1q_u8(block + 32), vld1q_u8(block + 48)));
+    if (vmaxvq_u8(any) >= 0x80) {
+      break;
+    }
+  }
+  // NEON has no movemask, so the block that ends the prefix is finished a
+  // word at a time.
+  return AsciiPrefixTail(haystack, pos);
+}
+#endif
+
+using AsciiPrefixFn = size_t (*)(std::string_view);
+
+static AsciiPrefixFn SelectAsciiPrefix() {
+#if defined(__x86_64__) || defined(__i386__)
+  if (CpuHasAvx2()) {
+    return AsciiPrefixAvx2;
+  }
+  return AsciiPrefixSse2;
+#elif defined(__aarch64__)
+  return AsciiPrefixNeon;
+#else
+  return [](std::string_view haystack) { return AsciiPrefixTail(haystack, 0); };
+#endif
+}
+
+static const AsciiPrefixFn kAsciiPrefix = SelectAsciiPrefix();
+
+size_t AsciiPrefix(std::string_view haystack) {
+  return kAsciiPrefix(haystack);
+}
+
+// FindFirstOfNibble follows the same pattern, but turns the hit mask into a
+// position. The final load may overlap bytes that were already scanned; they
+// held no hit, so the first set bit is still the first match.
+size_t FindFirstOfNibbleScalar(std::string_view haystack,
+                               const NibbleTables& tables) {
+  for (size_t i = 0; i < haystack.size(); ++i) {
+    auto b = static_cast<uint8_t>(haystack[i]);
+    if ((tables.lo[b & 0xf] & tables.hi[b >> 4]) != 0) {
+      return i;
+    }
+  }
+  return std::string_view::npos;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3"))) size_t FindFirstOfNibbleSsse3(
+    std::string_view haystack, const NibbleTables& tables) {
+  static constexpr size_t kWidth = sizeof(__m128i);
+  if (haystack.size() < kWidth) {
+    return FindFirstOfNibbleScalar(haystack, tables);
+  }
+
+  const __m128i lo = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.lo.data()));
+  const __m128i hi = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.hi.data()));
+  const char* begin = haystack.data();
+  const char* last = begin + haystack.size() - kWidth;
+  for (const char* data = begin; data < last; data += kWidth) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    if (uint32_t mask = SetMaskSsse3(chunk, lo, hi)) {
+      return data - begin + __builtin_ctz(mask);
+    }
+  }
+  __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last));
+  if (uint32_t mask = SetMaskSsse3(chunk, lo, hi)) {
+    return last - begin + __builtin_ctz(mask);
+  }
+  return std::string_view::npos;
+}
+
+__attribute__((target("avx2"))) size_t FindFirstOfNibbleAvx2(
+    std::string_view haystack, const NibbleTables& tables) {
+  static constexpr size_t kWidth = sizeof(__m256i);
+  if (haystack.size() < kWidth) {
+    return FindFirstOfNibbleSsse3(haystack, tables);
+  }
+
+  const __m256i lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.lo.data())));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.hi.data())));
+  const char* begin = haystack.data();
+  const char* last = begin + haystack.size() - kWidth;
+  for (const char* data = begin; data < last; data += kWidth) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    if (uint32_t mask = SetMaskAvx2(chunk, lo, hi)) {
+      return data - begin + __builtin_ctz(mask);
+    }
+  }
+  __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last));
+  if (uint32_t mask = SetMaskAvx2(chunk, lo, hi)) {
+    return last - begin + __builtin_ctz(mask);
+  }
+  return std::string_view::npos;
+}
+#endif
+
+#if defined(__aarch64__)
+// NEON has no movemask. Narrowing each 16-bit pair of lanes by 4 bits packs
+// the classified vector into a 64-bit mask with a nibble per lane.
+static inline uint64_t SetMaskNeon(uint8x16_t chunk, uint8x16_t lo,
+                                   uint8x16_t hi) {
+  uint8x16_t hits = vtstq_u8(ClassifyNeon(chunk, lo, hi), vdupq_n_u8(0xff));
+  uint8x8_t narrowed = vshrn_n_u16(vreinterpretq_u16_u8(hits), 4);
+  return vget_lane_u64(vreinterpret_u64_u8(narrowed), 0);
+}
+
+size_t FindFirstOfNibbleNeon(std::string_view haystack,
+                             const NibbleTables& tables) {
+  static constexpr size_t kWidth = sizeof(uint8x16_t);
+  if (haystack.size() < kWidth) {
+    return FindFirstOfNibbleScalar(haystack, tables);
+  }
+
+  const uint8x16_t lo = vld1q_u8(tables.lo.data());
+  const uint8x16_t hi = vld1q_u8(tables.hi.data());
+  const auto* begin = reinterpret_cast<const uint8_t*>(haystack.data());
+  const auto* last = begin + haystack.size() - kWidth;
+  for (const auto* data = begin; data < last; data += kWidth) {
+    if (uint64_t mask = SetMaskNeon(vld1q_u8(data), lo, hi)) {
+      return data - begin + __builtin_ctzll(mask) / 4;
+    }
+  }
+  if (uint64_t mask = SetMaskNeon(vld1q_u8(last), lo, hi)) {
+    return last - begin + __builtin_ctzll(mask) / 4;
+  }
+  return std::string_view::npos;
+}
+#endif
+
+using FindFirstOfFn = size_t (*)(std::string_view, const NibbleTables&);
+
+static FindFirstOfFn SelectFindFirstOfNibble() {
+#if defined(__x86_64__) || defined(__i386__)
+  if (CpuHasAvx2()) {
+    return FindFirstOfNibbleAvx2;
+  }
+  if (CpuHasSsse3()) {
+    return FindFirstOfNibbleSsse3;
+  }
+  return FindFirstOfNibbleScalar;
+#elif defined(__aarch64__)
+  return FindFirstOfNibbleNeon;
+#else
+  return FindFirstOfNibbleScalar;
+#endif
+}
+
+static const FindFirstOfFn kFindFirstOfNibble = SelectFindFirstOfNibble();
+
+size_t FindFirstOfNibble(std::string_view haystack,
+                         const NibbleTables& tables) {
+  return kFindFirstOfNibble(haystack, tables);
+}
+
+// CountOfNibble and FindAllOfNibble visit every match. Full vectors are
+// handled as usual; the remaining r < kWidth bytes are covered by one
+// overlapping load of the last kWidth bytes whose mask is shifted right by
+// kWidth - r, which drops the lanes that were already visited and leaves lane
+// i at position (end - r) + i.
+static size_t CountOfNibbleScalar(std::string_view haystack,
+                                  const NibbleTables& tables) {
+  size_t count = 0;
+  for (char c : haystack) {
+    auto b = static_cast<uint8_t>(c);
+    count += (tables.lo[b & 0xf] & tables.hi[b >> 4]) != 0;
+  }
+  return count;
+}
+
+// Appends base + i for every bit i of mask, as long as there is room.
+static inline size_t AppendPositions(uint64_t mask, int bits_per_lane,
+                                     size_t base, std::span<size_t> positions,
+                                     size_t n) {
+  for (; mask != 0 && n < positions.size(); mask &= mask - 1) {
+    positions[n++] = base + __builtin_ctzll(mask) / bits_per_lane;
+  }
+  return n;
+}
+
+static size_t FindAllOfNibbleScalar(std::string_view haystack,
+                                    const NibbleTables& tables,
+                                    std::span<size_t> positions) {
+  size_t n = 0;
+  for (size_t i = 0; i < haystack.size() && n < positions.size(); ++i) {
+    auto b = static_cast<uint8_t>(haystack[i]);
+    if ((tables.lo[b & 0xf] & tables.hi[b >> 4]) != 0) {
+      positions[n++] = i;
+    }
+  }
+  return n;
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3"))) static size_t CountOfNibbleSsse3(
+    std::string_view haystack, const NibbleTables& tables) {
+  static constexpr size_t kWidth = sizeof(__m128i);
+  if (haystack.size() < kWidth) {
+    return CountOfNibbleScalar(haystack, tables);
+  }
+
+  const __m128i lo = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.lo.data()));
+  const __m128i hi = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.hi.data()));
+  const char* data = haystack.data();
+  const char* end = data + haystack.size();
+  size_t count = 0;
+  for (; data + kWidth <= end; data += kWidth) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    count += __builtin_popcount(SetMaskSsse3(chunk, lo, hi));
+  }
+  if (data < end) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(end - kWidth));
+    count += __builtin_popcount(SetMaskSsse3(chunk, lo, hi) >>
+                                (kWidth - (end - data)));
+  }
+  return count;
+}
+
+__attribute__((target("ssse3"))) static size_t FindAllOfNibbleSsse3(
+    std::string_view haystack, const NibbleTables& tables,
+    std::span<size_t> positions) {
+  static constexpr size_t kWidth = sizeof(__m128i);
+  if (haystack.size() < kWidth) {
+    return FindAllOfNibbleScalar(haystack, tables, positions);
+  }
+
+  const __m128i lo = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.lo.data()));
+  const __m128i hi = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.hi.data()));
+  const char* begin = haystack.data();
+  const char* end = begin + haystack.size();
+  const char* data = begin;
+  size_t n = 0;
+  for (; data + kWidth <= end && n < positions.size(); data += kWidth) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    n = AppendPositions(SetMaskSsse3(chunk, lo, hi), 1, data - begin,
+                        positions, n);
+  }
+  // A full buffer ends the loop early, with data short of the tail.
+  if (data < end && n < positions.size()) {
+    __m128i chunk =
+        _mm_loadu_si128(reinterpret_cast<const __m128i*>(end - kWidth));
+    n = AppendPositions(SetMaskSsse3(chunk, lo, hi) >> (kWidth - (end - data)),
+                        1, data - begin, positions, n);
+  }
+  return n;
+}
+
+// Every AVX2 CPU also has popcnt.
+__attribute__((target("avx2,popcnt"))) static size_t CountOfNibbleAvx2(
+    std::string_view haystack, const NibbleTables& tables) {
+  static constexpr size_t kWidth = sizeof(__m256i);
+  if (haystack.size() < kWidth) {
+    return CountOfNibbleSsse3(haystack, tables);
+  }
+
+  const __m256i lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.lo.data())));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.hi.data())));
+  const char* data = haystack.data();
+  const char* end = data + haystack.size();
+  size_t count = 0;
+  for (; data + kWidth <= end; data += kWidth) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    count += __builtin_popcount(SetMaskAvx2(chunk, lo, hi));
+  }
+  if (data < end) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(end - kWidth));
+    count += __builtin_popcount(SetMaskAvx2(chunk, lo, hi) >>
+                                (kWidth - (end - data)));
+  }
+  return count;
+}
+
+__attribute__((target("avx2,bmi"))) static size_t FindAllOfNibbleAvx2(
+    std::string_view haystack, const NibbleTables& tables,
+    std::span<size_t> positions) {
+  static constexpr size_t kWidth = sizeof(__m256i);
+  if (haystack.size() < kWidth) {
+    return FindAllOfNibbleSsse3(haystack, tables, positions);
+  }
+
+  const __m256i lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.lo.data())));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.hi.data())));
+  const char* begin = haystack.data();
+  const char* end = begin + haystack.size();
+  const char* data = begin;
+  size_t n = 0;
+  for (; data + kWidth <= end && n < positions.size(); data += kWidth) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    n = AppendPositions(SetMaskAvx2(chunk, lo, hi), 1, data - begin,
+                        positions, n);
+  }
+  // A full buffer ends the loop early, with data short of the tail.
+  if (data < end && n < positions.size()) {
+    __m256i chunk =
+        _mm256_loadu_si256(reinterpret_cast<const __m256i*>(end - kWidth));
+    n = AppendPositions(SetMaskAvx2(chunk, lo, hi) >> (kWidth - (end - data)),
+                        1, data - begin, positions, n);
+  }
+  return n;
+}
+#endif
+
+#if defined(__aarch64__)
+// SetMaskNeon has 4 bits per lane, so the shifts are scaled by 4.
+static size_t CountOfNibbleNeon(std::string_view haystack,
+                                const NibbleTables& tables) {
+  static constexpr size_t kWidth = sizeof(uint8x16_t);
+  if (haystack.size() < kWidth) {
+    return CountOfNibbleScalar(haystack, tables);
+  }
+
+  const uint8x16_t lo = vld1q_u8(tables.lo.data());
+  const uint8x16_t hi = vld1q_u8(tables.hi.data());
+  const auto* data = reinterpret_cast<const uint8_t*>(haystack.data());
+  const auto* end = data + haystack.size();
+  size_t count = 0;
+  for (; data + kWidth <= end; data += kWidth) {
+    count += __builtin_popcountll(SetMaskNeon(vld1q_u8(data), lo, hi)) / 4;
+  }
+  if (data < end) {
+    uint64_t mask = SetMaskNeon(vld1q_u8(end - kWidth), lo, hi);
+    count += __builtin_popcountll(mask >> (4 * (kWidth - (end - data)))) / 4;
+  }
+  return count;
+}
+
+static size_t FindAllOfNibbleNeon(std::string_view haystack,
+                                  const NibbleTables& tables,
+                                  std::span<size_t> positions) {
+  static constexpr size_t kWidth = sizeof(uint8x16_t);
+  if (haystack.size() < kWidth) {
+    return FindAllOfNibbleScalar(haystack, tables, positions);
+  }
+
+  const uint8x16_t lo = vld1q_u8(tables.lo.data());
+  const uint8x16_t hi = vld1q_u8(tables.hi.data());
+  const auto* begin = reinterpret_cast<const uint8_t*>(haystack.data());
+  const auto* end = begin + haystack.size();
+  const auto* data = begin;
+  size_t n = 0;
+  for (; data + kWidth <= end && n < positions.size(); data += kWidth) {
+    // Keep one bit per lane so that clearing the lowest bit skips a lane.
+    uint64_t mask = SetMaskNeon(vld1q_u8(data), lo, hi) & 0x1111111111111111;
+    n = AppendPositions(mask, 4, data - begin, positions, n);
+  }
+  // A full buffer ends the loop early, with data short of the tail.
+  if (data < end && n < positions.size()) {
+    uint64_t mask =
+        SetMaskNeon(vld1q_u8(end - kWidth), lo, hi) & 0x1111111111111111;
+    n = AppendPositions(mask >> (4 * (kWidth - (end - data))), 4,
+                        data - begin, positions, n);
+  }
+  return n;
+}
+#endif
+
+using CountOfFn = size_t (*)(std::string_view, const NibbleTables&);
+using FindAllOfFn = size_t (*)(std::string_view, const NibbleTables&,
+                               std::span<size_t>);
+
+static CountOfFn SelectCountOfNibble() {
+#if defined(__x86_64__) || defined(__i386__)
+  if (CpuHasAvx2()) {
+    return CountOfNibbleAvx2;
+  }
+  if (CpuHasSsse3()) {
+    return CountOfNibbleSsse3;
+  }
+  return CountOfNibbleScalar;
+#elif defined(__aarch64__)
+  return CountOfNibbleNeon;
+#else
+  return CountOfNibbleScalar;
+#endif
+}
+
+static FindAllOfFn SelectFindAllOfNibble() {
+#if defined(__x86_64__) || defined(__i386__)
+  if (CpuHasAvx2()) {
+    return FindAllOfNibbleAvx2;
+  }
+  if (CpuHasSsse3()) {
+    return FindAllOfNibbleSsse3;
+  }
+  return FindAllOfNibbleScalar;
+#elif defined(__aarch64__)
+  return FindAllOfNibbleNeon;
+#else
+  return FindAllOfNibbleScalar;
+#endif
+}
+
+static const CountOfFn kCountOfNibble = SelectCountOfNibble();
+static const FindAllOfFn kFindAllOfNibble = SelectFindAllOfNibble();
+
+size_t CountOfNibble(std::string_view haystack, const NibbleTables& tables) {
+  return kCountOfNibble(haystack, tables);
+}
+
+size_t FindAllOfNibble(std::string_view haystack, const NibbleTables& tables,
+                       std::span<size_t> positions) {
+  return kFindAllOfNibble(haystack, tables, positions);
+}
+
+// How many strings ahead of the current one to prefetch.
+static constexpr size_t kPrefetchDistance = 8;
+
+// For a string longer than kPrefix, the part that the prefix load did not
+// cover. It is at least kPrefix bytes long, so the kernels don't fall back to
+// their scalar loop for it.
+static std::string_view AfterPrefix(std::string_view haystack) {
+  return haystack.substr(std::min(kPrefix, haystack.size() - kPrefix));
+}
+
+static void PrefetchHaystack(std::span<const std::string_view> haystacks,
+                             size_t i) {
+  if (i + kPrefetchDistance < haystacks.size()) {
+    __builtin_prefetch(haystacks[i + kPrefetchDistance].data());
+  }
+}
+
+static void HasAnyOfBatchLoop(std::span<const std::string_view> haystacks,
+                              const NibbleTables& tables,
+                              std::span<uint64_t> bits) {
+  std::fill(bits.begin(), bits.end(), 0);
+  for (size_t i = 0; i < haystacks.size(); ++i) {
+    PrefetchHaystack(haystacks, i);
+    bits[i / 64] |= uint64_t{HasAnyOfNibble(haystacks[i], tables)} << (i % 64);
+  }
+}
+
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3"))) static void HasAnyOfBatchSsse3(
+    std::span<const std::string_view> haystacks, const NibbleTables& tables,
+    std::span<uint64_t> bits) {
+  const __m128i lo = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.lo.data()));
+  const __m128i hi = _mm_loadu_si128(
+      reinterpret_cast<const __m128i*>(tables.hi.data()));
+  std::fill(bits.begin(), bits.end(), 0);
+  for (size_t i = 0; i < haystacks.size(); ++i) {
+    PrefetchHaystack(haystacks, i);
+    std::string_view haystack = haystacks[i];
+    uint32_t valid;
+    __m128i prefix = LoadPrefixSse2(haystack, &valid);
+    bool hit = (SetMaskSsse3(prefix, lo, hi) & valid) != 0 ||
+               (haystack.size() > kPrefix &&
+                HasAnyOfNibbleSsse3(AfterPrefix(haystack), tables));
+    bits[i / 64] |= uint64_t{hit} << (i % 64);
+  }
+}
+
+// Two strings per register: the prefix of haystacks[i] goes in the low lane
+// and the prefix of haystacks[i + 1] in the high lane.
+__attribute__((target("avx2"))) static void HasAnyOfBatchAvx2(
+    std::span<const std::string_view> haystacks, const NibbleTables& tables,
+    std::span<uint64_t> bits) {
+  const __m256i lo = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.lo.data())));
+  const __m256i hi = _mm256_broadcastsi128_si256(
+      _mm_loadu_si128(reinterpret_cast<const __m128i*>(tables.hi.data())));
+  auto rest_has_any = [&](std::string_view haystack) {
+    return haystack.size() > kPrefix &&
+           HasAnyOfNibbleAvx2(AfterPrefix(haystack), tables);
+  };
+
+  std::fill(bits.begin(), bits.end(), 0);
+  size_t i = 0;
+  for (; i + 2 <= haystacks.size(); i += 2) {
+    PrefetchHaystack(haystacks, i);
+    PrefetchHaystack(haystacks, i + 1);
+    uint32_t valid_lo, valid_hi;
+    __m128i prefix_lo = LoadPrefixSse2(haystacks[i], &valid_lo);
+    __m128i prefix_hi = LoadPrefixSse2(haystacks[i + 1], &valid_hi);
+    uint32_t mask =
+        SetMaskAvx2(_mm256_set_m128i(prefix_hi, prefix_lo), lo, hi);
+    bool hit_lo = (mask & valid_lo) != 0 || rest_has_any(haystacks[i]);
+    bool hit_hi =
+        (mask & (valid_hi << 16)) != 0 || rest_has_any(haystacks[i + 1]);
+    // i is even, so both bits are in the same word.
+    bits[i / 64] |= (uint64_t{hit_lo} | uint64_t{hit_hi} << 1) << (i % 64);
+  }
+  if (i < haystacks.size()) {
+    bits[i / 64] |= uint64_t{HasAnyOfNibbleAvx2(haystacks[i], tables)}
+                    << (i % 64);
+  }
+}
+#endif
+
+#if defined(__aarch64__)
+static void HasAnyOfBatchNeon(std::span<const std::string_view> haystacks,
+                              const NibbleTables& tables,
+                              std::span<uint64_t> bits) {
+  const uint8x16_t lo = vld1q_u8(tables.lo.data());
+  const uint8x16_t hi = vld1q_u8(tables.hi.data());
+  std::fill(bits.begin(), bits.end(), 0);
+  for (size_t i = 0; i < haystacks.size(); ++i) {
+    PrefetchHaystack(haystacks, i);
+    std::string_view haystack = haystacks[i];
+    uint8x16_t valid;
+    uint8x16_t prefix = LoadPrefixNeon(haystack, &valid);
+    bool hit = vmaxvq_u8(vandq_u8(ClassifyNeon(prefix, lo, hi), valid)) != 0 ||
+               (haystack.size() > kPrefix &&
+                HasAnyOfNibbleNeon(AfterPrefix(haystack), tables));
+    bits[i / 64] |= uint64_t{hit} << (i % 64);
+  }
+}
+#endif
+
+using HasAnyOfBatchFn = void (*)(std::span<const std::string_view>,
+                                 const NibbleTables&, std::span<uint64_t>);
+
+static HasAnyOfBatchFn SelectHasAnyOfBatch() {
+#if defined(__x86_64__) || defined(__i386__)
+  if (CpuHasAvx2()) {
+    return HasAnyOfBatchAvx2;
+  }
+  if (CpuHasSsse3()) {
+    return HasAnyOfBatchSsse3;
+  }
+  return HasAnyOfBatchLoop;
+#elif defined(__aarch64__)
+  return HasAnyOfBatchNeon;
+#else
+  return HasAnyOfBatchLoop;
+#endif
+}
+
+static const HasAnyOfBatchFn kHasAnyOfBatch = SelectHasAnyOfBatch();
+
+void HasAnyOfBatch(std::span<const std::string_view> haystacks,
+                   const NibbleTables& tables, std::span<uint64_t> bits) {
+  kHasAnyOfBatch(haystacks, tables, bits);
+}
+
+}  // namespace charscan
@@ -0,0 +1,165 @@
+// Byte-set scanning kernels shared by the benchmarks and the `main` CLI.
+
+#ifndef CHARSCAN_H_
+#define CHARSCAN_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <span>
+#include <string_view>
+
+namespace charscan {
+
+// Runtime CPU feature checks. Safe to call from static initializers.
+bool CpuHasSsse3();
+bool CpuHasAvx2();
+bool CpuHasAvx512Bw();
+
+// Byte-set classifier in the style of Hyperscan's "shufti" and simdjson's
+// character classification. A byte b is in the set iff
+//
+//   (lo[b & 0xf] & hi[b >> 4]) != 0
+//
+// Both lookups are a single shuffle (pshufb on x86, tbl on NEON), so testing
+// membership costs the same whether the set has 1 or 50 characters. Each bit of
+// the tables is a "bucket" of high nibbles that share the same set of low
+// nibbles. With 8 buckets, any set whose high nibbles have at most 8 distinct
+// low-nibble patterns is represented exactly; this covers every ASCII set.
+struct NibbleTables {
+  std::array<uint8_t, 16> lo = {};
+  std::array<uint8_t, 16> hi = {};
+};
+
+constexpr NibbleTables MakeNibbleTables(std::string_view set) {
+  // low_nibbles[h] is the set of low nibbles l such that (h << 4 | l) is in
+  // the set.
+  std::array<uint16_t, 16> low_nibbles = {};
+  for (char c : set) {
+    auto b = static_cast<uint8_t>(c);
+    low_nibbles[b >> 4] |= 1 << (b & 0xf);
+  }
+
+  NibbleTables tables;
+  std::array<uint16_t, 8> buckets = {};
+  int num_buckets = 0;
+  for (int h = 0; h < 16; ++h) {
+    if (low_nibbles[h] == 0) {
+      continue;
+    }
+    int bucket = 0;
+    while (bucket < num_buckets && buckets[bucket] != low_nibbles[h]) {
+      ++bucket;
+    }
+    if (bucket == num_buckets) {
+      // Not representable with 8 buckets. std::abort is not constexpr, so this
+      // is a compile error when the tables are built at compile time.
+      if (num_buckets == static_cast<int>(buckets.size())) {
+        std::abort();
+      }
+      buckets[num_buckets++] = low_nibbles[h];
+    }
+
+    tables.hi[h] |= 1 << bucket;
+    for (int l = 0; l < 16; ++l) {
+      if ((low_nibbles[h] >> l) & 1) {
+        tables.lo[l] |= 1 << bucket;
+      }
+    }
+  }
+
+  return tables;
+}
+
+// Returns whether any byte of haystack is in the set, using the widest
+// kernel the CPU supports. Haystacks of at most kShortHaystack bytes take a
+// loop-free path; see HasAnyOfNibbleShortSsse3 and friends below.
+inline constexpr size_t kShortHaystack = 64;
+bool HasAnyOfNibble(std::string_view haystack, const NibbleTables& tables);
+
+// Returns the position of the first byte of haystack that is in the set, or
+// std::string_view::npos.
+size_t FindFirstOfNibble(std::string_view haystack, const NibbleTables& tables);
+
+// Returns how many bytes of haystack are in the set.
+size_t CountOfNibble(std::string_view haystack, const NibbleTables& tables);
+
+// Writes the positions of the bytes of haystack that are in the set to
+// positions, in increasing order, and returns how many were written. Stops
+// early once positions is full; to continue, scan again after the last
+// position.
+size_t FindAllOfNibble(std::string_view haystack, const NibbleTables& tables,
+                       std::span<size_t> positions);
+
+// HasAnyOfNibble on num_threads threads, for haystacks far larger than the
+// caches. The haystack is split into kParallelBlockSize blocks that the
+// threads share by work stealing, and every thread stops as soon as any of
+// them finds a match. The threads besides the caller's come from a pool that
+// all calls share, which has one per core.
+inline constexpr size_t kParallelBlockSize = 256 << 10;
+bool HasAnyOfNibbleParallel(std::string_view haystack,
+                            const NibbleTables& tables, int num_threads);
+
+// The kernels HasAnyOfNibble chooses from, exposed for benchmarking. Each
+// requires the instruction set in its name.
+bool HasAnyOfNibbleScalar(std::string_view haystack,
+                          const NibbleTables& tables);
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3"))) bool HasAnyOfNibbleSsse3(
+    std::string_view haystack, const NibbleTables& tables);
+__attribute__((target("avx2"))) bool HasAnyOfNibbleAvx2(
+    std::string_view haystack, const NibbleTables& tables);
+#elif defined(__aarch64__)
+bool HasAnyOfNibbleNeon(std::string_view haystack, const NibbleTables& tables);
+#endif
+
+// Likewise for FindFirstOfNibble.
+size_t FindFirstOfNibbleScalar(std::string_view haystack,
+                               const NibbleTables& tables);
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3"))) size_t FindFirstOfNibbleSsse3(
+    std::string_view haystack, const NibbleTables& tables);
+__attribute__((target("avx2"))) size_t FindFirstOfNibbleAvx2(
+    std::string_view haystack, const NibbleTables& tables);
+#elif defined(__aarch64__)
+size_t FindFirstOfNibbleNeon(std::string_view haystack,
+                             const NibbleTables& tables);
+#endif
+
+// The same for haystacks of at most kShortHaystack bytes. These test the
+// whole haystack with a fixed number of vector loads and no scalar tail,
+// which may read outside the haystack but never outside its pages.
+#if defined(__x86_64__) || defined(__i386__)
+__attribute__((target("ssse3"))) bool HasAnyOfNibbleShortSsse3(
+    std::string_view haystack, const NibbleTables& tables);
+__attribute__((target("avx2"))) bool HasAnyOfNibbleShortAvx2(
+    std::string_view haystack, const NibbleTables& tables);
+__attribute__((target("avx512f,avx512bw"))) bool HasAnyOfNibbleShortAvx512(
+    std::string_view haystack, const NibbleTables& tables);
+#elif defined(__aarch64__)
+bool HasAnyOfNibbleShortNeon(std::string_view haystack,
+                             const NibbleTables& tables);
+#endif
+
+// The ASCII fast path of the UTF-8 kernels in utf8.h: the length of the
+// longest prefix of haystack whose bytes are all below 0x80.
+size_t AsciiPrefix(std::string_view haystack);
+
+// Batch queries. Short strings are answered from a single vector load of
+// their first 16 bytes, which may read past the end of the string. That is
+// safe as long as the load stays within the string's page, since protection is
+// per page; near the end of a page the load instead ends at the end of the
+// string. Either way, lanes that don't belong to the string are masked off.
+// Bit i of the result is set iff haystacks[i] contains a byte from the set.
+constexpr size_t BitVectorWords(size_t num_bits) {
+  return (num_bits + 63) / 64;
+}
+
+// bits must hold at least BitVectorWords(haystacks.size()) words.
+void HasAnyOfBatch(std::span<const std::string_view> haystacks,
+                   const NibbleTables& tables, std::span<uint64_t> bits);
+
+}  // namespace charscan
+
+#endif  // CHARSCAN_H_
@@ -0,0 +1,597 @@
+// Kernels templated over a character set that is known at compile time:
+// plain loops, SWAR, and the regex DFA in its variants. They live in a header
+// so that each set gets its own specialization; vowels.h compiles them once
+// for the vowels.
+
+#ifndef CHARSET_H_
+#define CHARSET_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <span>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "charscan.h"
+#include "multisearch.h"
+
+namespace charscan {
+
+// A character set that can be used as a template argument, e.g.
+// HasAnyOfLoop<CharSet("0123456789")>. Kernels templated over the set are
+// specialized for it at compile time.
+template <size_t N>
+struct CharSet {
+  constexpr CharSet(const char (&s)[N]) { std::copy_n(s, N, chars); }
+
+  constexpr std::string_view view() const { return {chars, N - 1}; }
+
+  char chars[N] = {};
+};
+
+// How CharSetMatcher tests a single byte for membership.
+enum class MatchStrategy {
+  // (c == set[0]) | (c == set[1]) | ..., fully unrolled.
+  kCompareChain,
+  // A shift and test against a 64-bit mask when the set spans fewer than 64
+  // byte values, otherwise a 256-bit bitmap.
+  kBitmask,
+  // A single load from a 256-entry table.
+  kTable,
+};
+
+template <CharSet Set>
+constexpr uint8_t MinByte() {
+  uint8_t min = std::numeric_limits<uint8_t>::max();
+  for (char c : Set.view()) {
+    min = std::min(min, static_cast<uint8_t>(c));
+  }
+  return min;
+}
+
+template <CharSet Set>
+constexpr uint8_t MaxByte() {
+  uint8_t max = 0;
+  for (char c : Set.view()) {
+    max = std::max(max, static_cast<uint8_t>(c));
+  }
+  return max;
+}
+
+// One or two compares beat a table load. Past that, the 256-entry table wins:
+// on x86 it was faster than the bitmask even for narrow, dense sets such as
+// the digits (the variable shift and range check cost more than an L1 hit), so
+// the bitmask is only used when it is asked for explicitly.
+template <CharSet Set>
+constexpr MatchStrategy DefaultMatchStrategy() {
+  if (Set.view().size() <= 2) {
+    return MatchStrategy::kCompareChain;
+  }
+  return MatchStrategy::kTable;
+}
+
+template <CharSet Set, MatchStrategy Strategy = DefaultMatchStrategy<Set>()>
+struct CharSetMatcher {
+  static constexpr std::string_view kChars = Set.view();
+
+  static constexpr bool Contains(char c) {
+    auto b = static_cast<uint8_t>(c);
+    if constexpr (Strategy == MatchStrategy::kCompareChain) {
+      return CompareChain(c, std::make_index_sequence<kChars.size()>());
+    } else if constexpr (Strategy == MatchStrategy::kBitmask && kNarrow) {
+      // Branch-free: the range check and the bit test are combined with &.
+      auto offset = static_cast<uint8_t>(b - kMin);
+      return ((kWindow >> (offset & 63)) & (offset < 64)) != 0;
+    } else if constexpr (Strategy == MatchStrategy::kBitmask) {
+      return ((kBitmap[b >> 6] >> (b & 63)) & 1) != 0;
+    } else {
+      return kTable[b];
+    }
+  }
+
+ private:
+  template <size_t... I>
+  static constexpr bool CompareChain(char c, std::index_sequence<I...>) {
+    // Bitwise or, so that the chain compiles to straight-line code.
+    return (false | ... | (c == kChars[I]));
+  }
+
+  static constexpr uint8_t kMin = MinByte<Set>();
+  static constexpr bool kNarrow = MaxByte<Set>() - kMin < 64;
+
+  static constexpr uint64_t kWindow = [] {
+    uint64_t window = 0;
+    for (char c : kChars) {
+      int offset = static_cast<uint8_t>(c) - kMin;
+      if (offset < 64) {
+        window |= uint64_t{1} << offset;
+      }
+    }
+    return window;
+  }();
+
+  static constexpr std::array<uint64_t, 4> kBitmap = [] {
+    std::array<uint64_t, 4> bitmap = {};
+    for (char c : kChars) {
+      auto b = static_cast<uint8_t>(c);
+      bitmap[b >> 6] |= uint64_t{1} << (b & 63);
+    }
+    return bitmap;
+  }();
+
+  static constexpr std::array<bool, 256> kTable = [] {
+    std::array<bool, 256> table = {};
+    for (char c : kChars) {
+      table[static_cast<uint8_t>(c)] = true;
+    }
+    return table;
+  }();
+};
+
+template <CharSet Set>
+bool HasAnyOfLoop(std::string_view haystack) {
+  for (char v : Set.view()) {
+    for (int i = 0; i < haystack.size(); ++i) {
+      if (haystack[i] == v) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+template <CharSet Set, MatchStrategy Strategy = DefaultMatchStrategy<Set>()>
+bool HasAnyOfLoopInterchanged(std::string_view haystack) {
+  for (int i = 0; i < haystack.size(); ++i) {
+    if (CharSetMatcher<Set, Strategy>::Contains(haystack[i])) {
+      return true;
+    }
+  }
+  return false;
+}
+
+
+// Kernels that must look at every match rather than stop at the first one.
+// The scalar versions use the same matcher as HasAnyOfLoopInterchanged; the
+// vector ones are the nibble kernels, which turn each vector of matches into
+// a bitmask and then popcount it or walk its set bits.
+template <CharSet Set, MatchStrategy Strategy = DefaultMatchStrategy<Set>()>
+size_t CountOfLoop(std::string_view haystack) {
+  size_t count = 0;
+  for (char c : haystack) {
+    count += CharSetMatcher<Set, Strategy>::Contains(c);
+  }
+  return count;
+}
+
+template <CharSet Set, MatchStrategy Strategy = DefaultMatchStrategy<Set>()>
+size_t FindFirstOfLoop(std::string_view haystack) {
+  for (size_t i = 0; i < haystack.size(); ++i) {
+    if (CharSetMatcher<Set, Strategy>::Contains(haystack[i])) {
+      return i;
+    }
+  }
+  return std::string_view::npos;
+}
+
+// Writes the positions of the matches to positions and returns how many were
+// written, stopping once positions is full, like FindAllOfNibble.
+template <CharSet Set, MatchStrategy Strategy = DefaultMatchStrategy<Set>()>
+size_t FindAllOfLoop(std::string_view haystack, std::span<size_t> positions) {
+  size_t n = 0;
+  for (size_t i = 0; i < haystack.size() && n < positions.size(); ++i) {
+    if (CharSetMatcher<Set, Strategy>::Contains(haystack[i])) {
+      positions[n++] = i;
+    }
+  }
+  return n;
+}
+
+// SWAR ("SIMD within a register"): 8 bytes per step with plain 64-bit
+// arithmetic, for targets where intrinsics are not an option. word ^ (c *
+// kSwarOnes) has a zero byte wherever word has c, and SwarNonZeroBytes finds
+// those exactly: (y & 0x7f) + 0x7f never carries into the next byte, so unlike
+// the usual (y - 0x01) & ~y trick there are no false positives next to a real
+// match.
+inline constexpr uint64_t kSwarOnes = 0x0101010101010101;
+inline constexpr uint64_t kSwarLow7 = 0x7f7f7f7f7f7f7f7f;
+
+// The high bit of each byte of the result is clear iff that byte of y is zero.
+constexpr uint64_t SwarNonZeroBytes(uint64_t y) {
+  return ((y & kSwarLow7) + kSwarLow7) | y;
+}
+
+// Pairs of bytes in the set that differ only in 0x20, such as the two cases of
+// a letter, share one test against word | 0x20: c | 0x20 matches exactly c and
+// c ^ 0x20. For the vowels this halves the work.
+template <CharSet Set>
+struct SwarCandidates {
+  static constexpr size_t kMax = Set.view().size();
+  static constexpr auto kCandidates = [] {
+    struct {
+      std::array<uint8_t, kMax> folded = {};
+      size_t num_folded = 0;
+      std::array<uint8_t, kMax> exact = {};
+      size_t num_exact = 0;
+    } candidates;
+    for (char c : Set.view()) {
+      auto b = static_cast<uint8_t>(c);
+      const bool other_case_in_set =
+          Set.view().find(static_cast<char>(b ^ 0x20)) !=
+          std::string_view::npos;
+      if (!other_case_in_set) {
+        candidates.exact[candidates.num_exact++] = b;
+      } else if ((b & 0x20) != 0) {
+        candidates.folded[candidates.num_folded++] = b;
+      }
+    }
+    return candidates;
+  }();
+
+  // Returns a word whose byte i has its high bit set iff byte i of word is in
+  // the set; the other bits are garbage.
+  static constexpr uint64_t Matches(uint64_t word) {
+    return ~(
+        Match(word | (kSwarOnes * 0x20), kCandidates.folded,
+              std::make_index_sequence<kCandidates.num_folded>()) &
+        Match(word, kCandidates.exact,
+              std::make_index_sequence<kCandidates.num_exact>()));
+  }
+
+ private:
+  // With no candidates of a kind, I is empty and neither word nor chars is
+  // read.
+  template <size_t... I>
+  static constexpr uint64_t Match(
+      [[maybe_unused]] uint64_t word,
+      [[maybe_unused]] const std::array<uint8_t, kMax>& chars,
+      std::index_sequence<I...>) {
+    return (~uint64_t{0} & ... &
+            SwarNonZeroBytes(word ^ (kSwarOnes * chars[I])));
+  }
+};
+
+template <CharSet Set>
+constexpr bool SwarAnyInSet(uint64_t word) {
+  return (SwarCandidates<Set>::Matches(word) & ~kSwarLow7) != 0;
+}
+
+inline uint64_t LoadWord(const char* data) {
+  uint64_t word;
+  std::memcpy(&word, data, sizeof(word));
+  return word;
+}
+
+// Unaligned loads, four words per branch. The final word overlaps the ones
+// before it rather than falling back to a scalar tail.
+template <CharSet Set>
+bool HasAnyOfSwar(std::string_view haystack) {
+  static constexpr size_t kWord = sizeof(uint64_t);
+  if (haystack.size() < kWord) {
+    return HasAnyOfLoopInterchanged<Set>(haystack);
+  }
+
+  const char* data = haystack.data();
+  const char* last = data + haystack.size() - kWord;
+  for (; data + 4 * kWord <= last; data += 4 * kWord) {
+    const uint64_t matches = SwarCandidates<Set>::Matches(LoadWord(data)) |
+                             SwarCandidates<Set>::Matches(LoadWord(data + 8)) |
+                             SwarCandidates<Set>::Matches(LoadWord(data + 16)) |
+                             SwarCandidates<Set>::Matches(LoadWord(data + 24));
+    if ((matches & ~kSwarLow7) != 0) {
+      return true;
+    }
+  }
+  for (; data < last; data += kWord) {
+    if (SwarAnyInSet<Set>(LoadWord(data))) {
+      return true;
+    }
+  }
+  return SwarAnyInSet<Set>(LoadWord(last));
+}
+
+// For targets where unaligned loads fault or are emulated: a scalar head up
+// to the first 8-byte boundary, aligned words, and a scalar tail.
+template <CharSet Set>
+bool HasAnyOfSwarAligned(std::string_view haystack) {
+  static constexpr size_t kWord = sizeof(uint64_t);
+  const size_t head = std::min(
+      haystack.size(),
+      -reinterpret_cast<uintptr_t>(haystack.data()) & (kWord - 1));
+  if (HasAnyOfLoopInterchanged<Set>(haystack.substr(0, head))) {
+    return true;
+  }
+
+  const char* data = haystack.data() + head;
+  const char* end = haystack.data() + haystack.size();
+  for (; data + kWord <= end; data += kWord) {
+    if (SwarAnyInSet<Set>(LoadWord(std::assume_aligned<kWord>(data)))) {
+      return true;
+    }
+  }
+  return HasAnyOfLoopInterchanged<Set>({data, end});
+}
+
+// The regex kernels run [set] as a two-state DFA: kReject until a byte of
+// the set is seen, kAccept from then on.
+inline constexpr char kCharMin = std::numeric_limits<char>::min();
+inline constexpr char kCharMax = std::numeric_limits<char>::max();
+inline constexpr int kSize = kCharMax - kCharMin + 1;
+
+// The DFA is indexed by the byte value, not by the (possibly negative) char.
+// Every lookup must go through ByteIndex.
+constexpr uint8_t ByteIndex(char c) { return static_cast<uint8_t>(c); }
+
+inline constexpr int kReject = 0;
+inline constexpr int kAccept = 1;
+
+// The single-byte case of an Aho-Corasick automaton: with one needle per byte
+// of the set, every needle goes straight from the start state to the match
+// state, and there are no other states.
+static_assert(kReject == kAhoCorasickStart);
+static_assert(kAccept == kAhoCorasickMatch);
+
+// State is the type of a table entry. uint8_t keeps a row at 256 bytes; int is
+// the original layout, kept around for comparison.
+template <typename State = uint8_t>
+constexpr std::array<std::array<State, kSize>, 2> MakeRegexTable(
+    std::string_view set) {
+  std::vector<std::string_view> needles;
+  for (size_t i = 0; i < set.size(); ++i) {
+    needles.push_back(set.substr(i, 1));
+  }
+  const std::vector<uint32_t> dfa =
+      MakeAhoCorasickDfa(needles, IdentityByteClasses());
+
+  std::array<std::array<State, kSize>, 2> tbl = {};
+  for (int state : {kReject, kAccept}) {
+    for (int idx = 0; idx < kSize; ++idx) {
+      tbl[state][idx] = dfa[state * kSize + idx];
+    }
+  }
+  return tbl;
+}
+
+template <CharSet Set>
+inline constexpr auto kRegexTableOf = MakeRegexTable(Set.view());
+
+template <CharSet Set>
+bool HasAnyOfRegex(std::string_view haystack) {
+  int state = kReject;
+  for (auto c : haystack) {
+    state = kRegexTableOf<Set>[state][ByteIndex(c)];
+  }
+
+  return state == kAccept;
+}
+
+template <CharSet Set>
+bool HasAnyOfRegexEarlyReturn(std::string_view haystack) {
+  int state = kReject;
+  for (auto c : haystack) {
+    state = kRegexTableOf<Set>[state][ByteIndex(c)];
+    if (state == kAccept) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+template <CharSet Set>
+inline constexpr auto kRegexIntTableOf = MakeRegexTable<int>(Set.view());
+
+template <CharSet Set>
+bool HasAnyOfRegexInt(std::string_view haystack) {
+  int state = kReject;
+  for (auto c : haystack) {
+    state = kRegexIntTableOf<Set>[state][ByteIndex(c)];
+  }
+
+  return state == kAccept;
+}
+
+// Each DFA step waits on the load of the previous one, so a single stream is
+// bound by L1 latency rather than throughput. This runs N independent streams
+// over N contiguous segments of the haystack, giving the out-of-order core N
+// loads to overlap.
+//
+// Every segment is started from kReject. That is exact for this DFA: kAccept
+// is absorbing, so a segment entered in kAccept ends in kAccept, and one
+// entered in kReject ends wherever its own stream did. Merging the segments
+// left to right is therefore a fold over that rule. The streams are checked
+// for kAccept once per block so that strings with an early match still return
+// early.
+template <CharSet Set, int N>
+bool HasAnyOfRegexInterleaved(std::string_view haystack) {
+  static constexpr size_t kBlock = 64;
+  const auto& table = kRegexTableOf<Set>;
+  const char* data = haystack.data();
+  const size_t segment = haystack.size() / N;
+
+  // The streams are unrolled by hand (rather than with a loop over k) so that
+  // every state lives in its own register; otherwise they can end up in a
+  // stack array and the store-to-load forwarding re-serializes the streams.
+  std::array<uint8_t, N> states;
+  states.fill(kReject);
+  auto step = [&]<size_t... K>(size_t i, std::index_sequence<K...>) {
+    ((states[K] = table[states[K]][ByteIndex(data[K * segment + i])]), ...);
+    return ((states[K] == kAccept) || ...);
+  };
+  for (size_t begin = 0; begin < segment; begin += kBlock) {
+    const size_t end = std::min(segment, begin + kBlock);
+    bool accepted = false;
+    // kAccept is absorbing, so the last step of the block sees every match.
+    for (size_t i = begin; i < end; ++i) {
+      accepted = step(i, std::make_index_sequence<N>());
+    }
+    if (accepted) {
+      return true;
+    }
+  }
+
+  // The last segment also takes the bytes left over by the division.
+  for (size_t i = N * segment; i < haystack.size(); ++i) {
+    states[N - 1] = table[states[N - 1]][ByteIndex(data[i])];
+  }
+
+  int state = kReject;
+  for (int k = 0; k < N; ++k) {
+    state = state == kAccept ? kAccept : states[k];
+  }
+  return state == kAccept;
+}
+
+// Alphabet compression. Two bytes are in the same equivalence class if every
+// state sends them to the same next state, so the DFA only needs one column
+// per class: a 256-byte class map plus a NumStates x NumClasses table, which
+// stays in L1 even when there are many states. Entries are premultiplied by
+// NumClasses, i.e. a state is the offset of its row, so a step is
+//
+//   state = transitions[state + byte_class[c]]
+//
+// with no multiply on the critical path.
+template <size_t NumStates, size_t NumClasses>
+struct ClassDfa {
+  static constexpr uint8_t Premultiply(int state) { return state * NumClasses; }
+
+  std::array<uint8_t, kSize> byte_class = {};
+  std::array<uint8_t, NumStates * NumClasses> transitions = {};
+};
+
+template <size_t NumStates>
+struct DfaByteClasses {
+  std::array<uint8_t, kSize> byte_class = {};
+  size_t num_classes = 0;
+};
+
+template <typename State, size_t NumStates>
+constexpr DfaByteClasses<NumStates> MakeDfaByteClasses(
+    const std::array<std::array<State, kSize>, NumStates>& table) {
+  DfaByteClasses<NumStates> classes;
+  // representative[k] is the first byte assigned to class k.
+  std::array<int, kSize> representative = {};
+  for (int b = 0; b < kSize; ++b) {
+    size_t k = 0;
+    for (; k < classes.num_classes; ++k) {
+      bool same = true;
+      for (size_t s = 0; s < NumStates; ++s) {
+        same = same && table[s][b] == table[s][representative[k]];
+      }
+      if (same) {
+        break;
+      }
+    }
+    if (k == classes.num_classes) {
+      representative[classes.num_classes++] = b;
+    }
+    classes.byte_class[b] = k;
+  }
+  return classes;
+}
+
+template <size_t NumClasses, typename State, size_t NumStates>
+constexpr ClassDfa<NumStates, NumClasses> MakeClassDfa(
+    const std::array<std::array<State, kSize>, NumStates>& table,
+    const DfaByteClasses<NumStates>& classes) {
+  static_assert(NumStates * NumClasses <= 256,
+                "premultiplied states must fit in uint8_t");
+  ClassDfa<NumStates, NumClasses> dfa;
+  dfa.byte_class = classes.byte_class;
+  for (int b = 0; b < kSize; ++b) {
+    for (size_t s = 0; s < NumStates; ++s) {
+      dfa.transitions[s * NumClasses + classes.byte_class[b]] =
+          dfa.Premultiply(table[s][b]);
+    }
+  }
+  return dfa;
+}
+
+template <CharSet Set>
+inline constexpr auto kRegexClassesOf = MakeDfaByteClasses(kRegexTableOf<Set>);
+
+template <CharSet Set>
+inline constexpr auto kClassDfaOf =
+    MakeClassDfa<kRegexClassesOf<Set>.num_classes>(kRegexTableOf<Set>,
+                                                   kRegexClassesOf<Set>);
+
+template <CharSet Set>
+bool HasAnyOfRegexClasses(std::string_view haystack) {
+  constexpr auto& dfa = kClassDfaOf<Set>;
+  uint8_t state = dfa.Premultiply(kReject);
+  for (auto c : haystack) {
+    state = dfa.transitions[state + dfa.byte_class[ByteIndex(c)]];
+  }
+
+  return state == dfa.Premultiply(kAccept);
+}
+
+template <CharSet Set>
+bool HasAnyOfRegexClassesEarlyReturn(std::string_view haystack) {
+  constexpr auto& dfa = kClassDfaOf<Set>;
+  uint8_t state = dfa.Premultiply(kReject);
+  for (auto c : haystack) {
+    state = dfa.transitions[state + dfa.byte_class[ByteIndex(c)]];
+    if (state == dfa.Premultiply(kAccept)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// The nibble tables for Set, for the kernels in charscan.h.
+template <CharSet Set>
+inline constexpr auto kNibbleTablesOf = MakeNibbleTables(Set.view());
+
+// Scans a haystack that arrives in pieces, e.g. the read() buffers of a file
+// too large to hold in memory. The DFA state is carried from one chunk to the
+// next, so the answer does not depend on where the chunks are split. Once the
+// state reaches kAccept (which is absorbing), later chunks are not read.
+template <CharSet Set>
+class StreamingScanner {
+ public:
+  // Feeds the next chunk through the DFA. Returns whether a match has been
+  // seen so far.
+  bool Scan(std::string_view chunk) {
+    static constexpr size_t kBlock = 64;
+    const auto& table = kRegexTableOf<Set>;
+    // As in HasAnyOfRegexInterleaved, kAccept is only checked once per block
+    // so that the inner loop has no branch.
+    for (size_t begin = 0; begin < chunk.size() && !matched();
+         begin += kBlock) {
+      const size_t end = std::min(chunk.size(), begin + kBlock);
+      for (size_t i = begin; i < end; ++i) {
+        state_ = table[state_][ByteIndex(chunk[i])];
+      }
+    }
+    return matched();
+  }
+
+  // Same as Scan, but the chunk is tested with the vectorized nibble
+  // classifier. This DFA has a single non-accepting state, so "any byte of the
+  // chunk is in the set" is exactly its transition on the whole chunk.
+  bool ScanSimd(std::string_view chunk) {
+    if (!matched() && HasAnyOfNibble(chunk, kNibbleTablesOf<Set>)) {
+      state_ = kAccept;
+    }
+    return matched();
+  }
+
+  bool matched() const { return state_ == kAccept; }
+
+  void Reset() { state_ = kReject; }
+
+ private:
+  uint8_t state_ = kReject;
+};
+
+}  // namespace charscan
+
+#endif  // CHARSET_H_
@@ -0,0 +1,118 @@
+#include "corpus.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "vowels.h"
+
+namespace charscan {
+
+void FillRandom(uint64_t seed, double vowel_probability,
+                std::span<char> data) {
+  static constexpr size_t kBlock = 1 << 20;
+  const size_t num_blocks = (data.size() + kBlock - 1) / kBlock;
+  const size_t num_threads = std::min<size_t>(
+      num_blocks, std::max(1u, std::thread::hardware_concurrency()));
+
+  std::atomic<size_t> next_block = 0;
+  auto fill_blocks = [&] {
+    for (size_t block; (block = next_block++) < num_blocks;) {
+      std::mt19937 rng(static_cast<std::mt19937::result_type>(
+          MixSeed(seed, block)));
+      std::bernoulli_distribution is_vowel(vowel_probability);
+      std::uniform_int_distribution<> vowel_dist(0, kVowels.size() - 1);
+      std::uniform_int_distribution<> other_dist(0, kCharsNoVowels.size() - 1);
+      const size_t end = std::min(data.size(), (block + 1) * kBlock);
+      for (size_t i = block * kBlock; i < end; ++i) {
+        data[i] = is_vowel(rng) ? kVowels[vowel_dist(rng)]
+                                : kCharsNoVowels[other_dist(rng)];
+      }
+    }
+  };
+
+  std::vector<std::thread> threads;
+  for (size_t i = 1; i < num_threads; ++i) {
+    threads.emplace_back(fill_blocks);
+  }
+  fill_blocks();
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+void PlaceFirstVowel(uint64_t seed, size_t first_vowel, StringCorpus& corpus) {
+  std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+  std::uniform_int_distribution<> vowel_dist(0, kVowels.size() - 1);
+  std::uniform_int_distribution<> other_dist(0, kCharsNoVowels.size() - 1);
+  for (size_t i = 0; i < corpus.size(); ++i) {
+    std::span<char> s = corpus.mutable_string(i);
+    if (first_vowel >= s.size()) {
+      continue;
+    }
+    for (size_t j = 0; j < first_vowel; ++j) {
+      if (kVowels.find(s[j]) != std::string_view::npos) {
+        s[j] = kCharsNoVowels[other_dist(rng)];
+      }
+    }
+    s[first_vowel] = kVowels[vowel_dist(rng)];
+  }
+}
+
+void FillUtf8Random(uint64_t seed, double non_ascii_probability,
+                    double vowel_probability, StringCorpus& corpus) {
+  std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+  std::bernoulli_distribution is_vowel(vowel_probability);
+  std::bernoulli_distribution is_non_ascii(non_ascii_probability);
+  std::uniform_int_distribution<> vowel_dist(
+      0, std::size(kUtf8AccentedVowels) - 1);
+  std::uniform_int_distribution<> non_ascii_dist(
+      0, std::size(kUtf8NonVowels) - 1);
+  std::uniform_int_distribution<> other_dist(0, kCharsNoVowels.size() - 1);
+  for (size_t i = 0; i < corpus.size(); ++i) {
+    std::span<char> s = corpus.mutable_string(i);
+    for (size_t j = 0; j < s.size();) {
+      std::string_view c;
+      if (is_vowel(rng)) {
+        c = kUtf8AccentedVowels[vowel_dist(rng)];
+      } else if (is_non_ascii(rng)) {
+        c = kUtf8NonVowels[non_ascii_dist(rng)];
+      }
+      if (c.empty() || c.size() > s.size() - j) {
+        c = kCharsNoVowels.substr(other_dist(rng), 1);
+      }
+      std::copy(c.begin(), c.end(), s.begin() + j);
+      j += c.size();
+    }
+  }
+}
+
+StringCorpus RepeatZipf(uint64_t seed, const StringCorpus& distinct,
+                        int num_strings, double exponent) {
+  std::vector<double> weights(distinct.size());
+  for (size_t k = 0; k < weights.size(); ++k) {
+    weights[k] = std::pow(k + 1, -exponent);
+  }
+  std::mt19937 rng(static_cast<std::mt19937::result_type>(seed));
+  std::discrete_distribution<size_t> rank(weights.begin(), weights.end());
+  StringCorpus corpus;
+  for (int i = 0; i < num_strings; ++i) {
+    corpus.Append(distinct[rank(rng)]);
+  }
+  return corpus;
+}
+
+std::vector<std::string> MakeHeapStrings(const StringCorpus& corpus) {
+  return {corpus.begin(), corpus.end()};
+}
+
+}  // namespace charscan
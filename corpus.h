@@ -0,0 +1,244 @@
+// Generated benchmark and test inputs: random strings over an alphabet with
+// and without vowels, with a chosen vowel density, stored back to back.
+
+#ifndef CORPUS_H_
+#define CORPUS_H_
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "vowels.h"
+
+namespace charscan {
+
+inline constexpr std::string_view kCharsWithVowels =
+    "0123456789"
+    "abcdefghijklmnopqrstuvwxyz"
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+
+inline constexpr std::string_view kCharsNoVowels =
+    "0123456789"
+    "bcdfghjklmnpqrstvwxyz"
+    "BCDFGHJKLMNPQRSTVWXYZ";
+
+constexpr auto ShortStringDistribution(std::mt19937& rng) {
+  return [&]() {
+    std::binomial_distribution<> d(15, 0.5);
+    return d(rng) + 5;
+  };
+}
+
+constexpr auto LongStringDistribution(std::mt19937& rng) {
+  return [&]() {
+    std::binomial_distribution<> d(10000, 0.5);
+    return d(rng);
+  };
+}
+
+constexpr auto FixedLengthDistribution(size_t length) {
+  return [=](std::mt19937&) { return [=]() { return length; }; };
+}
+
+inline constexpr double kUniformVowelProbability =
+    static_cast<double>(kVowels.size()) / kCharsWithVowels.size();
+
+// Strings stored back to back in a single arena, with an offsets array
+// marking where each one starts. Iterating yields string_views into the arena,
+// so a pass over the corpus reads memory sequentially instead of chasing one
+// heap pointer per string.
+class StringCorpus {
+ public:
+  class Iterator {
+   public:
+    using iterator_category = std::forward_iterator_tag;
+    using value_type = std::string_view;
+    using difference_type = std::ptrdiff_t;
+    using pointer = void;
+    using reference = std::string_view;
+
+    Iterator() = default;
+    Iterator(const StringCorpus* corpus, size_t i) : corpus_(corpus), i_(i) {}
+
+    std::string_view operator*() const { return (*corpus_)[i_]; }
+    Iterator& operator++() {
+      ++i_;
+      return *this;
+    }
+    Iterator operator++(int) {
+      Iterator old = *this;
+      ++i_;
+      return old;
+    }
+    bool operator==(const Iterator& other) const { return i_ == other.i_; }
+
+   private:
+    const StringCorpus* corpus_ = nullptr;
+    size_t i_ = 0;
+  };
+
+  StringCorpus() = default;
+
+  template <typename Strings>
+  explicit StringCorpus(const Strings& strings) {
+    size_t bytes = 0;
+    for (std::string_view s : strings) {
+      bytes += s.size();
+    }
+    arena_.reserve(bytes);
+    offsets_.reserve(std::size(strings) + 1);
+    for (std::string_view s : strings) {
+      Append(s);
+    }
+  }
+
+  // A corpus of strings with the given lengths, whose contents are written
+  // through mutable_arena().
+  static StringCorpus WithLengths(std::span<const size_t> lengths) {
+    StringCorpus corpus;
+    corpus.offsets_.reserve(lengths.size() + 1);
+    for (size_t length : lengths) {
+      corpus.offsets_.push_back(corpus.offsets_.back() + length);
+    }
+    corpus.arena_.resize(corpus.offsets_.back());
+    return corpus;
+  }
+
+  void Append(std::string_view s) {
+    arena_.append(s);
+    offsets_.push_back(arena_.size());
+  }
+
+  size_t size() const { return offsets_.size() - 1; }
+  size_t bytes() const { return arena_.size(); }
+  std::span<char> mutable_arena() { return arena_; }
+  std::span<char> mutable_string(size_t i) {
+    return {arena_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]};
+  }
+
+  std::string_view operator[](size_t i) const {
+    return {arena_.data() + offsets_[i], offsets_[i + 1] - offsets_[i]};
+  }
+
+  Iterator begin() const { return {this, 0}; }
+  Iterator end() const { return {this, size()}; }
+
+ private:
+  std::string arena_;
+  // String i is arena_[offsets_[i], offsets_[i + 1]).
+  std::vector<size_t> offsets_ = {0};
+};
+
+// SplitMix64. Derives independent, reproducible seeds from a base seed.
+constexpr uint64_t MixSeed(uint64_t seed, uint64_t stream) {
+  uint64_t z = seed + (stream + 1) * 0x9e3779b97f4a7c15;
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+// Fills data with random characters using every core: each byte is a vowel
+// with probability vowel_probability, drawn uniformly from kVowels, and
+// otherwise a character drawn uniformly from kCharsNoVowels. With probability
+// kUniformVowelProbability this is the same as drawing uniformly from
+// kCharsWithVowels. Each fixed-size block has its own generator seeded from
+// (seed, block), so the output depends only on the seed and not on the number
+// of threads. (It does depend on the standard library, whose distributions
+// are implementation-defined.)
+void FillRandom(uint64_t seed, double vowel_probability,
+                std::span<char> data);
+
+inline constexpr size_t kNoFirstVowel = std::numeric_limits<size_t>::max();
+
+// Makes every string that is longer than first_vowel have its first vowel at
+// exactly that position.
+void PlaceFirstVowel(uint64_t seed, size_t first_vowel, StringCorpus& corpus);
+
+// string_length(rng) returns a generator of string lengths, e.g.
+// ShortStringDistribution. The lengths are drawn sequentially; the characters,
+// which are most of the work, in parallel. If first_vowel is given, the first
+// vowel of every string long enough to have one there is at exactly that
+// position.
+template <typename T>
+StringCorpus MakeStrings(uint64_t seed, int num_strings, T string_length,
+                         double vowel_probability,
+                         size_t first_vowel = kNoFirstVowel) {
+  std::mt19937 rng(static_cast<std::mt19937::result_type>(MixSeed(seed, 0)));
+  std::vector<size_t> lengths(num_strings);
+  std::generate(lengths.begin(), lengths.end(), string_length(rng));
+
+  StringCorpus corpus = StringCorpus::WithLengths(lengths);
+  FillRandom(MixSeed(seed, 1), vowel_probability, corpus.mutable_arena());
+  if (first_vowel != kNoFirstVowel) {
+    PlaceFirstVowel(MixSeed(seed, 2), first_vowel, corpus);
+  }
+  return corpus;
+}
+
+// Letters outside ASCII that are not in kUtf8VowelSet, in two and three
+// bytes: Latin consonants with diacritics, Greek, Cyrillic and CJK.
+inline constexpr std::string_view kUtf8NonVowels[] = {
+    "ç", "ñ", "ß", "ł", "ž", "λ", "π", "σ", "б",
+    "д", "ж", "л", "ш", "я", "中", "文", "字",
+};
+
+// Vowels outside ASCII, from kUtf8VowelSet.
+inline constexpr std::string_view kUtf8AccentedVowels[] = {
+    "é", "è", "ü", "ö", "å", "ø", "ó", "ā", "œ",
+};
+
+// Fills each string of corpus with UTF-8 text: each character is a vowel from
+// kUtf8AccentedVowels with probability vowel_probability, otherwise a letter
+// from kUtf8NonVowels with probability non_ascii_probability, and otherwise a
+// character of kCharsNoVowels. A multibyte character that would not fit at
+// the end of a string is replaced by ASCII, so every string is valid UTF-8 of
+// exactly its length. Single-threaded, unlike FillRandom.
+void FillUtf8Random(uint64_t seed, double non_ascii_probability,
+                    double vowel_probability, StringCorpus& corpus);
+
+// MakeStrings for FillUtf8Random. The lengths are in bytes.
+template <typename T>
+StringCorpus MakeUtf8Strings(uint64_t seed, int num_strings, T string_length,
+                             double non_ascii_probability,
+                             double vowel_probability) {
+  std::mt19937 rng(static_cast<std::mt19937::result_type>(MixSeed(seed, 0)));
+  std::vector<size_t> lengths(num_strings);
+  std::generate(lengths.begin(), lengths.end(), string_length(rng));
+
+  StringCorpus corpus = StringCorpus::WithLengths(lengths);
+  FillUtf8Random(MixSeed(seed, 1), non_ascii_probability, vowel_probability,
+                 corpus);
+  return corpus;
+}
+
+// num_strings strings drawn from `distinct` with Zipfian repetition: the
+// string of rank k, i.e. distinct[k - 1], with probability proportional to
+// 1 / k^exponent. With exponent 1 and 10'000 distinct strings, the top 1%
+// make up about half the draws.
+StringCorpus RepeatZipf(uint64_t seed, const StringCorpus& distinct,
+                        int num_strings, double exponent);
+
+// MakeStrings for num_distinct strings, then RepeatZipf of them.
+template <typename T>
+StringCorpus MakeZipfStrings(uint64_t seed, int num_strings, int num_distinct,
+                             double exponent, T string_length,
+                             double vowel_probability) {
+  const StringCorpus distinct = MakeStrings(MixSeed(seed, 0), num_distinct,
+                                            string_length, vowel_probability);
+  return RepeatZipf(MixSeed(seed, 1), distinct, num_strings, exponent);
+}
+
+// The same strings, one std::string (and, for long strings, one heap
+// allocation) each.
+std::vector<std::string> MakeHeapStrings(const StringCorpus& corpus);
+
+}  // namespace charscan
+
+#endif  // CORPUS_H_
@@ -0,0 +1,178 @@
+// Strings that are appended to and modified in place, with a summary of which
+// parts hold a byte of the set, so that asking again after a change does not
+// rescan what did not change.
+
+#ifndef INCREMENTAL_H_
+#define INCREMENTAL_H_
+
+#include <algorithm>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "charset.h"
+
+namespace charscan {
+
+// A string kept as a list of fixed-size chunks, each with its DFA end state
+// (see StreamingScanner), and a count of the chunks in kAccept. Append scans
+// only the new bytes, continuing from the last chunk's state, and once that
+// chunk has matched not even those; Replace rescans only the chunks it
+// writes to. HasAny is O(1).
+template <CharSet Set>
+class ChunkedString {
+ public:
+  static constexpr size_t kChunkBytes = 4096;
+
+  void Append(std::string_view s) {
+    size_ += s.size();
+    while (!s.empty()) {
+      if (chunks_.empty() || chunks_.back().bytes.size() == kChunkBytes) {
+        chunks_.emplace_back();
+        chunks_.back().bytes.reserve(kChunkBytes);
+      }
+      Chunk& chunk = chunks_.back();
+      const std::string_view piece =
+          s.substr(0, kChunkBytes - chunk.bytes.size());
+      chunk.bytes.append(piece);
+      const bool matched = chunk.scanner.matched();
+      matched_chunks_ += chunk.scanner.ScanSimd(piece) && !matched;
+      s.remove_prefix(piece.size());
+    }
+  }
+
+  // Overwrites the bytes at [pos, pos + s.size()), which must exist.
+  void Replace(size_t pos, std::string_view s) {
+    while (!s.empty()) {
+      Chunk& chunk = chunks_[pos / kChunkBytes];
+      const size_t offset = pos % kChunkBytes;
+      const std::string_view piece = s.substr(0, kChunkBytes - offset);
+      chunk.bytes.replace(offset, piece.size(), piece);
+      matched_chunks_ -= chunk.scanner.matched();
+      chunk.scanner.Reset();
+      matched_chunks_ += chunk.scanner.ScanSimd(chunk.bytes);
+      pos += piece.size();
+      s.remove_prefix(piece.size());
+    }
+  }
+
+  bool HasAny() const { return matched_chunks_ > 0; }
+
+  size_t size() const { return size_; }
+
+ private:
+  struct Chunk {
+    std::string bytes;
+    StreamingScanner<Set> scanner;
+  };
+
+  std::vector<Chunk> chunks_;
+  size_t size_ = 0;
+  size_t matched_chunks_ = 0;
+};
+
+// The same, with the range query "is there a byte of the set in [begin,
+// end)" in O(log n). Leaf k of the segment tree is the bitmask of the bytes of
+// the set in the k-th kBlock-byte block, and every node above is whether any
+// leaf below it is nonzero. The partial blocks at the ends of a range are
+// answered from their masks, and the whole blocks between from O(log n)
+// nodes. Append and Replace recompute the masks of the blocks they write to
+// and the nodes above them; an Append past the leaves doubles them, so it is
+// amortized O(1) per block.
+template <CharSet Set>
+class SegmentTreeString {
+ public:
+  static constexpr size_t kBlock = 64;
+
+  void Append(std::string_view s) {
+    const size_t pos = bytes_.size();
+    bytes_.append(s);
+    const size_t num_blocks = (bytes_.size() + kBlock - 1) / kBlock;
+    if (num_blocks > leaves_) {
+      leaves_ = std::bit_ceil(num_blocks);
+      masks_.resize(leaves_);
+      any_.assign(2 * leaves_, 0);
+      Update(0, num_blocks);
+    } else {
+      Update(pos / kBlock, num_blocks);
+    }
+  }
+
+  // Overwrites the bytes at [pos, pos + s.size()), which must exist.
+  void Replace(size_t pos, std::string_view s) {
+    if (s.empty()) {
+      return;
+    }
+    bytes_.replace(pos, s.size(), s);
+    Update(pos / kBlock, (pos + s.size() - 1) / kBlock + 1);
+  }
+
+  bool AnyIn(size_t begin, size_t end) const {
+    end = std::min(end, bytes_.size());
+    if (begin >= end) {
+      return false;
+    }
+    const size_t first = begin / kBlock;
+    const size_t last = (end - 1) / kBlock;
+    const uint64_t head = ~uint64_t{0} << (begin % kBlock);
+    const uint64_t tail = ~uint64_t{0} >> (kBlock - 1 - (end - 1) % kBlock);
+    if (first == last) {
+      return (masks_[first] & head & tail) != 0;
+    }
+    if ((masks_[first] & head) != 0 || (masks_[last] & tail) != 0) {
+      return true;
+    }
+    // The nodes that cover leaves [first + 1, last) exactly.
+    for (size_t l = first + 1 + leaves_, r = last + leaves_; l < r;
+         l /= 2, r /= 2) {
+      if ((l % 2 == 1 && any_[l++]) || (r % 2 == 1 && any_[--r])) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  bool HasAny() const { return leaves_ > 0 && any_[1]; }
+
+  size_t size() const { return bytes_.size(); }
+
+ private:
+  // Recomputes the masks of blocks [first, last) and the nodes above them.
+  void Update(size_t first, size_t last) {
+    if (first >= last) {
+      return;
+    }
+    const std::string_view bytes = bytes_;
+    for (size_t k = first; k < last; ++k) {
+      const std::string_view block = bytes.substr(k * kBlock, kBlock);
+      uint64_t mask = 0;
+      for (size_t i = 0; i < block.size(); ++i) {
+        mask |= uint64_t{kRegexTableOf<Set>[kReject][ByteIndex(block[i])] ==
+                         kAccept}
+                << i;
+      }
+      masks_[k] = mask;
+      any_[leaves_ + k] = mask != 0;
+    }
+    for (size_t l = (first + leaves_) / 2, r = (last - 1 + leaves_) / 2; l > 0;
+         l /= 2, r /= 2) {
+      for (size_t node = l; node <= r; ++node) {
+        any_[node] = any_[2 * node] || any_[2 * node + 1];
+      }
+    }
+  }
+
+  std::string bytes_;
+  // Leaf k is masks_[k] and any_[leaves_ + k]; node i has children 2i and
+  // 2i + 1. leaves_ is a power of two.
+  std::vector<uint64_t> masks_;
+  std::vector<uint8_t> any_;
+  size_t leaves_ = 0;
+};
+
+}  // namespace charscan
+
+#endif  // INCREMENTAL_H_
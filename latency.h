@@ -0,0 +1,138 @@
+// Per-call latency: a cheap timestamp counter, and a histogram to collect the
+// timings in without disturbing the code being timed.
+
+#ifndef LATENCY_H_
+#define LATENCY_H_
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+namespace charscan {
+
+// A timestamp in ticks of the CPU's constant-rate counter: the TSC on x86, the
+// virtual counter on ARM, nanoseconds elsewhere. The fences keep the code
+// being timed from moving across the read in either direction.
+//
+// The ARM counter runs much slower than the core (24 MHz on Apple M1), so
+// there a single short call often reads as zero ticks; the percentiles of
+// many calls are still right to within a tick.
+inline uint64_t ReadTicks() {
+#if defined(__x86_64__) || defined(__i386__)
+  _mm_lfence();
+  const uint64_t ticks = __rdtsc();
+  _mm_lfence();
+  return ticks;
+#elif defined(__aarch64__)
+  uint64_t ticks;
+  asm volatile("isb\n\tmrs %0, cntvct_el0" : "=r"(ticks) : : "memory");
+  return ticks;
+#else
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+#endif
+}
+
+// Measured against steady_clock the first time it is called, which takes
+// about 10 ms.
+inline double TicksPerNanosecond() {
+  static const double ticks_per_ns = [] {
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point start = Clock::now();
+    const uint64_t start_ticks = ReadTicks();
+    Clock::time_point end;
+    do {
+      end = Clock::now();
+    } while (end - start < std::chrono::milliseconds(10));
+    const uint64_t ticks = ReadTicks() - start_ticks;
+    const std::chrono::duration<double, std::nano> elapsed = end - start;
+    return ticks / elapsed.count();
+  }();
+  return ticks_per_ns;
+}
+
+// What timing nothing at all reads as: the fastest of many back-to-back
+// reads. Subtracting it from each timing leaves the code being timed; using
+// the fastest means no timing is made out to be shorter than it was.
+inline uint64_t TimerOverheadTicks() {
+  static const uint64_t overhead = [] {
+    uint64_t fastest = UINT64_MAX;
+    for (int i = 0; i < 10'000; ++i) {
+      const uint64_t start = ReadTicks();
+      fastest = std::min(fastest, ReadTicks() - start);
+    }
+    return fastest;
+  }();
+  return overhead;
+}
+
+// A histogram of unsigned values in the style of HdrHistogram: each power of
+// two is split into kSubBuckets equal buckets, so every value is kept to
+// within 1/kSubBuckets of itself and values below kSubBuckets exactly. That
+// takes 8 KiB for the whole range of uint64_t, and Record() is a few integer
+// instructions and one increment.
+class LatencyHistogram {
+ public:
+  static constexpr int kSubBucketBits = 4;
+  static constexpr uint64_t kSubBuckets = uint64_t{1} << kSubBucketBits;
+
+  void Record(uint64_t value) {
+    ++counts_[BucketOf(value)];
+    ++count_;
+  }
+
+  uint64_t count() const { return count_; }
+
+  // The value below which a fraction `quantile` of the recorded values lie,
+  // e.g. 0.99 for p99: the middle of the bucket holding that rank. Zero if
+  // nothing was recorded.
+  double Percentile(double quantile) const {
+    if (count_ == 0) return 0;
+    const uint64_t rank = std::clamp<uint64_t>(
+        static_cast<uint64_t>(std::ceil(quantile * count_)), 1, count_);
+    uint64_t seen = 0;
+    for (size_t bucket = 0; bucket < kNumBuckets; ++bucket) {
+      seen += counts_[bucket];
+      if (seen >= rank) {
+        return LowestValueOf(bucket) + (WidthOf(bucket) - 1) / 2.0;
+      }
+    }
+    return LowestValueOf(kNumBuckets - 1);
+  }
+
+ private:
+  // Values below kSubBuckets get a bucket each. Above, a value whose top bit
+  // is bit `e` is in row e - kSubBucketBits + 1, and its next kSubBucketBits
+  // bits pick the bucket in the row.
+  static constexpr size_t kNumBuckets = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  static size_t BucketOf(uint64_t value) {
+    if (value < kSubBuckets) return value;
+    const int shift = 63 - __builtin_clzll(value) - kSubBucketBits;
+    return (shift + 1) * kSubBuckets + (value >> shift) - kSubBuckets;
+  }
+  static uint64_t LowestValueOf(size_t bucket) {
+    if (bucket < kSubBuckets) return bucket;
+    const int shift = bucket / kSubBuckets - 1;
+    return (bucket % kSubBuckets + kSubBuckets) << shift;
+  }
+  static uint64_t WidthOf(size_t bucket) {
+    if (bucket < kSubBuckets) return 1;
+    return uint64_t{1} << (bucket / kSubBuckets - 1);
+  }
+
+  std::array<uint64_t, kNumBuckets> counts_ = {};
+  uint64_t count_ = 0;
+};
+
+}  // namespace charscan
+
+#endif  // LATENCY_H_
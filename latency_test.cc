@@ -0,0 +1,48 @@
+#include "latency.h"
+
+#include <cstdint>
+
+#include "gtest/gtest.h"
+
+namespace charscan {
+namespace {
+
+TEST(LatencyHistogram, Empty) {
+  const LatencyHistogram histogram;
+  EXPECT_EQ(histogram.count(), 0);
+  EXPECT_EQ(histogram.Percentile(0.5), 0);
+}
+
+TEST(LatencyHistogram, SmallValuesAreExact) {
+  LatencyHistogram histogram;
+  for (uint64_t value = 0; value < LatencyHistogram::kSubBuckets; ++value) {
+    histogram.Record(value);
+  }
+  EXPECT_EQ(histogram.Percentile(0), 0);
+  EXPECT_EQ(histogram.Percentile(0.5), LatencyHistogram::kSubBuckets / 2 - 1);
+  EXPECT_EQ(histogram.Percentile(1), LatencyHistogram::kSubBuckets - 1);
+}
+
+TEST(LatencyHistogram, PercentilesWithinBucketPrecision) {
+  LatencyHistogram histogram;
+  for (uint64_t value = 1; value <= 100'000; ++value) histogram.Record(value);
+  histogram.Record(UINT64_MAX);
+  EXPECT_EQ(histogram.count(), 100'001);
+  const double precision = 1.0 / LatencyHistogram::kSubBuckets;
+  for (double quantile : {0.01, 0.5, 0.9, 0.99, 0.999}) {
+    const double expected = quantile * 100'001;
+    EXPECT_NEAR(histogram.Percentile(quantile), expected, expected * precision)
+        << quantile;
+  }
+  EXPECT_GE(histogram.Percentile(1), UINT64_MAX * (1 - precision));
+}
+
+TEST(ReadTicks, Advances) {
+  const uint64_t start = ReadTicks();
+  EXPECT_GT(TicksPerNanosecond(), 0);
+  EXPECT_GT(ReadTicks(), start);
+  EXPECT_LT(TimerOverheadTicks(), 10'000 * TicksPerNanosecond());
+}
+
+}  // namespace
+}  // namespace charscan
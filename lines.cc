@@ -0,0 +1,45 @@
+#include "lines.h"
+
+#include <algorithm>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "charscan.h"
+
+namespace charscan {
+
+std::string LineSet(std::string_view set) {
+  std::string line_set(set);
+  std::erase(line_set, '\n');
+  return line_set;
+}
+
+// Rather than testing one line at a time, this jumps to the next byte in the
+// set and expands that to its line, so non-matching lines are skipped at the
+// speed of the vector kernel.
+void ScanLines(std::string_view text, const NibbleTables& tables,
+               bool count_only, std::string_view prefix, uint64_t& count,
+               std::string& output) {
+  size_t pos = 0;
+  while (pos < text.size()) {
+    size_t hit = FindFirstOfNibble(text.substr(pos), tables);
+    if (hit == std::string_view::npos) break;
+    hit += pos;
+    // pos is a line start, so this never searches further back than pos.
+    size_t begin = text.rfind('\n', hit);
+    begin = begin == std::string_view::npos ? 0 : begin + 1;
+    size_t end = text.find('\n', hit);
+    if (end == std::string_view::npos) end = text.size();
+
+    ++count;
+    if (!count_only) {
+      output += prefix;
+      output.append(text.substr(begin, end - begin));
+      output += '\n';
+    }
+    pos = end + 1;
+  }
+}
+
+}  // namespace charscan
@@ -0,0 +1,29 @@
+// The line matching of the `main` CLI, separate from its I/O so it can be
+// tested.
+
+#ifndef LINES_H_
+#define LINES_H_
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "charscan.h"
+
+namespace charscan {
+
+// The bytes of set that a line can contain: all but '\n', which like in grep
+// is the line terminator and never part of a match.
+std::string LineSet(std::string_view set);
+
+// Counts the lines of text that contain a byte of the set, which must not
+// contain '\n' (see LineSet). Unless count_only, appends each of them to
+// output, after prefix and followed by a newline. text starts at a line
+// boundary; its last line need not end in a newline.
+void ScanLines(std::string_view text, const NibbleTables& tables,
+               bool count_only, std::string_view prefix, uint64_t& count,
+               std::string& output);
+
+}  // namespace charscan
+
+#endif  // LINES_H_
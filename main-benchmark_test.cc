@@ -1,12 +1,80 @@
+// The cost of each part of the harness the other benchmarks are built from,
+// from the innermost out. See calibration.h.
+
+#include <string_view>
+
 #include "benchmark/benchmark.h"
+#include "calibration.h"
+#include "corpus.h"
+
+using charscan::NoopKernel;
+using charscan::ShortStringDistribution;
+using charscan::StringCorpus;
+
+int Noop() { return 0; }
 
-int Noop() {
-    return 0;
+// One pass of `for (auto _ : state)`.
+static void BM_EmptyLoop(benchmark::State& state) {
+  for (auto _ : state) {
+  }
 }
+BENCHMARK(BM_EmptyLoop);
 
+// The loop plus DoNotOptimize of a value the compiler can see.
 static void BM_Noop(benchmark::State& state) {
-    for (auto _ : state) {
-        benchmark::DoNotOptimize(Noop());
-    }
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Noop());
+  }
 }
 BENCHMARK(BM_Noop);
+
+// The rest are per string over a corpus like the short-string datasets, so
+// their items_per_second is the harness's ceiling on strings per second.
+static const StringCorpus& Corpus() {
+  static const auto* corpus = new StringCorpus(charscan::MakeStrings(
+      /*seed=*/42, 1'000, ShortStringDistribution, /*vowel_probability=*/0));
+  return *corpus;
+}
+
+// Iterating over the strings, without calling anything.
+static void BM_RangeFor(benchmark::State& state) {
+  const StringCorpus& strs = Corpus();
+  for (auto _ : state) {
+    for (std::string_view s : strs) benchmark::DoNotOptimize(s);
+  }
+  state.SetItemsProcessed(state.iterations() * strs.size());
+}
+BENCHMARK(BM_RangeFor);
+
+// What BENCHMARK_HAS_VOWEL runs, with a kernel that does nothing. This is
+// what vowels-benchmark_test subtracts.
+static void BM_DirectCall(benchmark::State& state) {
+  const StringCorpus& strs = Corpus();
+  for (auto _ : state) {
+    for (std::string_view s : strs) benchmark::DoNotOptimize(NoopKernel(s));
+  }
+  state.SetItemsProcessed(state.iterations() * strs.size());
+}
+BENCHMARK(BM_DirectCall);
+
+// The same through a function pointer the compiler cannot see through, as
+// when a kernel is picked at run time.
+static void BM_IndirectCall(benchmark::State& state) {
+  const StringCorpus& strs = Corpus();
+  bool (*kernel)(std::string_view) = NoopKernel;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(kernel);
+    for (std::string_view s : strs) benchmark::DoNotOptimize(kernel(s));
+  }
+  state.SetItemsProcessed(state.iterations() * strs.size());
+}
+BENCHMARK(BM_IndirectCall);
+
+// HarnessNsPerString, which measures BM_DirectCall's loop without the
+// library, should agree with it.
+static void BM_HarnessNsPerString(benchmark::State& state) {
+  double ns = 0;
+  for (auto _ : state) ns = charscan::HarnessNsPerString(Corpus());
+  state.counters["ns/string"] = ns;
+}
+BENCHMARK(BM_HarnessNsPerString)->Iterations(1);
@@ -1,5 +1,71 @@
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+#include "charscan.h"
 #include "gtest/gtest.h"
+#include "lines.h"
+
+namespace charscan {
+namespace {
 
 TEST(Main, SimpleTest) {
     EXPECT_EQ(0, 0);
 }
+
+struct Lines {
+  uint64_t count = 0;
+  std::string output;
+};
+
+Lines Scan(std::string_view text, std::string_view set,
+           std::string_view prefix = "") {
+  Lines lines;
+  ScanLines(text, MakeNibbleTables(LineSet(set)), /*count_only=*/false, prefix,
+            lines.count, lines.output);
+  return lines;
+}
+
+TEST(ScanLines, PrintsMatchingLines) {
+  const Lines lines = Scan("ab\ncd\nef\nxa\n", "ae");
+  EXPECT_EQ(lines.count, 3);
+  EXPECT_EQ(lines.output, "ab\nef\nxa\n");
+}
+
+TEST(ScanLines, PrintsEachLineOnce) {
+  const Lines lines = Scan("aaa\nbab\n", "ab");
+  EXPECT_EQ(lines.count, 2);
+  EXPECT_EQ(lines.output, "aaa\nbab\n");
+}
+
+TEST(ScanLines, LastLineWithoutNewline) {
+  const Lines lines = Scan("xy\nza", "a", "f:");
+  EXPECT_EQ(lines.count, 1);
+  EXPECT_EQ(lines.output, "f:za\n");
+}
+
+TEST(ScanLines, CountOnly) {
+  uint64_t count = 0;
+  std::string output;
+  ScanLines("a\nb\na\n", MakeNibbleTables("a"), /*count_only=*/true, "", count,
+            output);
+  EXPECT_EQ(count, 2);
+  EXPECT_EQ(output, "");
+}
+
+// grep never matches the line terminator, so a newline in the set matches
+// nothing, and in particular not the end of every line.
+TEST(ScanLines, NewlineInSet) {
+  EXPECT_EQ(LineSet("a\nb\n"), "ab");
+
+  Lines lines = Scan("ab\ncd\nef\n", "\n");
+  EXPECT_EQ(lines.count, 0);
+  EXPECT_EQ(lines.output, "");
+
+  lines = Scan("ab\ncd\n\nef\n", "\nd");
+  EXPECT_EQ(lines.count, 1);
+  EXPECT_EQ(lines.output, "cd\n");
+}
+
+}  // namespace
+}  // namespace charscan
@@ -0,0 +1,250 @@
+#include "multisearch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "charscan.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace charscan {
+
+AhoCorasick::AhoCorasick(std::span<const std::string_view> needles)
+    : classes_(MakeByteClasses(needles)),
+      table_(MakeAhoCorasickDfa(needles, classes_)) {
+  for (uint32_t& next : table_) {
+    next *= classes_.size;
+  }
+}
+
+bool AhoCorasick::ContainsAny(std::string_view haystack) const {
+  static constexpr size_t kBlock = 64;
+  const uint32_t match = kAhoCorasickMatch * classes_.size;
+  uint32_t state = kAhoCorasickStart;
+  // As in StreamingScanner::Scan, the match state is only checked once per
+  // block, so that the inner loop has no branch.
+  for (size_t begin = 0; begin < haystack.size(); begin += kBlock) {
+    const size_t end = std::min(haystack.size(), begin + kBlock);
+    for (size_t i = begin; i < end; ++i) {
+      state = table_[state + classes_.of[static_cast<uint8_t>(haystack[i])]];
+    }
+    if (state == match) {
+      return true;
+    }
+  }
+  return false;
+}
+
+bool Teddy::Verify(std::string_view haystack, size_t pos,
+                   uint8_t buckets) const {
+  const std::string_view rest = haystack.substr(pos);
+  for (; buckets != 0; buckets &= buckets - 1) {
+    for (uint32_t needle : buckets_[__builtin_ctz(buckets)]) {
+      if (rest.starts_with(needles_[needle])) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// Each kernel loads a vector at pos and classifies it once per prefix byte.
+// Classification k is shifted down by k lanes, so that after and-ing them lane
+// j holds the buckets whose first kPrefix bytes may match at pos + j. The top
+// kPrefix - 1 lanes lack the bytes to decide that, so consecutive vectors
+// overlap by that much, and the last vector is moved back to end at the end
+// of the haystack instead of running past it.
+struct TeddyKernels {
+#if defined(__x86_64__) || defined(__i386__)
+  __attribute__((target("ssse3"))) static inline __m128i ClassifySsse3(
+      __m128i chunk, __m128i lo, __m128i hi) {
+    const __m128i nibble = _mm_set1_epi8(0x0f);
+    return _mm_and_si128(
+        _mm_shuffle_epi8(lo, _mm_and_si128(chunk, nibble)),
+        _mm_shuffle_epi8(hi, _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble)));
+  }
+
+  template <int kPrefix>
+  __attribute__((target("ssse3"))) static bool ContainsAnySsse3(
+      const Teddy& teddy, std::string_view haystack) {
+    static constexpr size_t kWidth = sizeof(__m128i);
+    static constexpr size_t kStride = kWidth - (kPrefix - 1);
+    static constexpr uint32_t kStarts = (1u << kStride) - 1;
+    __m128i lo[kPrefix], hi[kPrefix];
+    for (int k = 0; k < kPrefix; ++k) {
+      lo[k] = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(teddy.masks_[k].lo.data()));
+      hi[k] = _mm_loadu_si128(
+          reinterpret_cast<const __m128i*>(teddy.masks_[k].hi.data()));
+    }
+    const char* data = haystack.data();
+    for (size_t pos = 0;; pos += kStride) {
+      const bool last = pos + kWidth >= haystack.size();
+      if (last) {
+        pos = haystack.size() - kWidth;
+      }
+      const __m128i chunk =
+          _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + pos));
+      __m128i candidates = ClassifySsse3(chunk, lo[0], hi[0]);
+      if constexpr (kPrefix > 1) {
+        candidates = _mm_and_si128(
+            candidates,
+            _mm_srli_si128(ClassifySsse3(chunk, lo[1], hi[1]), 1));
+      }
+      if constexpr (kPrefix > 2) {
+        candidates = _mm_and_si128(
+            candidates,
+            _mm_srli_si128(ClassifySsse3(chunk, lo[2], hi[2]), 2));
+      }
+      uint32_t starts =
+          ~_mm_movemask_epi8(_mm_cmpeq_epi8(candidates, _mm_setzero_si128())) &
+          kStarts;
+      if (starts != 0) {
+        alignas(16) uint8_t buckets[kWidth];
+        _mm_store_si128(reinterpret_cast<__m128i*>(buckets), candidates);
+        for (; starts != 0; starts &= starts - 1) {
+          const int j = __builtin_ctz(starts);
+          if (teddy.Verify(haystack, pos + j, buckets[j])) {
+            return true;
+          }
+        }
+      }
+      if (last) {
+        return false;
+      }
+    }
+  }
+#endif
+
+#if defined(__aarch64__)
+  static inline uint8x16_t ClassifyNeon(uint8x16_t chunk, uint8x16_t lo,
+                                        uint8x16_t hi) {
+    return vandq_u8(vqtbl1q_u8(lo, vandq_u8(chunk, vdupq_n_u8(0x0f))),
+                    vqtbl1q_u8(hi, vshrq_n_u8(chunk, 4)));
+  }
+
+  template <int kPrefix>
+  static bool ContainsAnyNeon(const Teddy& teddy, std::string_view haystack) {
+    static constexpr size_t kWidth = sizeof(uint8x16_t);
+    static constexpr size_t kStride = kWidth - (kPrefix - 1);
+    // 4 bits per lane; see SetMaskNeon in charscan.cc.
+    static constexpr uint64_t kStarts =
+        kStride == 16 ? ~uint64_t{0} : (uint64_t{1} << (4 * kStride)) - 1;
+    uint8x16_t lo[kPrefix], hi[kPrefix];
+    for (int k = 0; k < kPrefix; ++k) {
+      lo[k] = vld1q_u8(teddy.masks_[k].lo.data());
+      hi[k] = vld1q_u8(teddy.masks_[k].hi.data());
+    }
+    const auto* data = reinterpret_cast<const uint8_t*>(haystack.data());
+    const uint8x16_t zero = vdupq_n_u8(0);
+    for (size_t pos = 0;; pos += kStride) {
+      const bool last = pos + kWidth >= haystack.size();
+      if (last) {
+        pos = haystack.size() - kWidth;
+      }
+      const uint8x16_t chunk = vld1q_u8(data + pos);
+      uint8x16_t candidates = ClassifyNeon(chunk, lo[0], hi[0]);
+      if constexpr (kPrefix > 1) {
+        candidates = vandq_u8(
+            candidates, vextq_u8(ClassifyNeon(chunk, lo[1], hi[1]), zero, 1));
+      }
+      if constexpr (kPrefix > 2) {
+        candidates = vandq_u8(
+            candidates, vextq_u8(ClassifyNeon(chunk, lo[2], hi[2]), zero, 2));
+      }
+      const uint8x8_t narrowed = vshrn_n_u16(
+          vreinterpretq_u16_u8(vtstq_u8(candidates, vdupq_n_u8(0xff))), 4);
+      uint64_t starts =
+          vget_lane_u64(vreinterpret_u64_u8(narrowed), 0) & kStarts &
+          0x1111111111111111;
+      if (starts != 0) {
+        alignas(16) uint8_t buckets[kWidth];
+        vst1q_u8(buckets, candidates);
+        for (; starts != 0; starts &= starts - 1) {
+          const int j = __builtin_ctzll(starts) / 4;
+          if (teddy.Verify(haystack, pos + j, buckets[j])) {
+            return true;
+          }
+        }
+      }
+      if (last) {
+        return false;
+      }
+    }
+  }
+#endif
+
+  static auto Select(int prefix) -> bool (*)(const Teddy&, std::string_view) {
+#if defined(__x86_64__) || defined(__i386__)
+    if (!CpuHasSsse3()) {
+      return nullptr;
+    }
+    switch (prefix) {
+      case 1:
+        return ContainsAnySsse3<1>;
+      case 2:
+        return ContainsAnySsse3<2>;
+      case 3:
+        return ContainsAnySsse3<3>;
+    }
+#elif defined(__aarch64__)
+    switch (prefix) {
+      case 1:
+        return ContainsAnyNeon<1>;
+      case 2:
+        return ContainsAnyNeon<2>;
+      case 3:
+        return ContainsAnyNeon<3>;
+    }
+#endif
+    return nullptr;
+  }
+};
+
+Teddy::Teddy(std::span<const std::string_view> needles) : fallback_(needles) {
+  for (std::string_view needle : needles) {
+    if (!needle.empty()) {
+      needles_.emplace_back(needle);
+    }
+  }
+  if (needles_.empty() || needles_.size() > kMaxNeedles) {
+    return;
+  }
+
+  // Sorted, neighbouring needles tend to share their first bytes, so giving
+  // each bucket a contiguous run of them sets fewer bits in the masks.
+  std::sort(needles_.begin(), needles_.end());
+  prefix_ = static_cast<int>(masks_.size());
+  for (const std::string& needle : needles_) {
+    prefix_ = std::min<int>(prefix_, needle.size());
+  }
+  for (size_t i = 0; i < needles_.size(); ++i) {
+    const size_t bucket = i * kNumBuckets / needles_.size();
+    buckets_[bucket].push_back(i);
+    for (int k = 0; k < prefix_; ++k) {
+      auto b = static_cast<uint8_t>(needles_[i][k]);
+      masks_[k].lo[b & 0xf] |= 1 << bucket;
+      masks_[k].hi[b >> 4] |= 1 << bucket;
+    }
+  }
+  scan_ = TeddyKernels::Select(prefix_);
+}
+
+bool Teddy::ContainsAny(std::string_view haystack) const {
+  // The kernels need at least one full vector.
+  if (scan_ == nullptr || haystack.size() < 16) {
+    return fallback_.ContainsAny(haystack);
+  }
+  return scan_(*this, haystack);
+}
+
+}  // namespace charscan
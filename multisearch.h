@@ -0,0 +1,195 @@
+// Multi-needle search: does a haystack contain any of a set of short
+// needles? This is the general case of HasAnyOfNibble, whose needles are
+// single bytes.
+
+#ifndef MULTISEARCH_H_
+#define MULTISEARCH_H_
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "charscan.h"
+
+namespace charscan {
+
+// Maps each byte to a column of an Aho-Corasick table. Bytes that occur in no
+// needle all behave the same, so they share class 0, and each byte that does
+// occur gets a column of its own. A row then has one more entry than the
+// needles have distinct bytes, instead of 256.
+struct ByteClasses {
+  std::array<uint16_t, 256> of = {};
+  size_t size = 1;
+};
+
+constexpr ByteClasses MakeByteClasses(
+    std::span<const std::string_view> needles) {
+  ByteClasses classes;
+  for (std::string_view needle : needles) {
+    for (char c : needle) {
+      auto b = static_cast<uint8_t>(c);
+      if (classes.of[b] == 0) {
+        classes.of[b] = classes.size++;
+      }
+    }
+  }
+  return classes;
+}
+
+// One class per byte, for tables that are indexed by the byte itself.
+constexpr ByteClasses IdentityByteClasses() {
+  ByteClasses classes;
+  for (size_t b = 0; b < classes.of.size(); ++b) {
+    classes.of[b] = b;
+  }
+  classes.size = classes.of.size();
+  return classes;
+}
+
+// The DFA built below starts in kAhoCorasickStart and enters
+// kAhoCorasickMatch as soon as any needle has been read. The match state is
+// never left, so the haystack contains a needle iff the scan ends there.
+inline constexpr uint32_t kAhoCorasickStart = 0;
+inline constexpr uint32_t kAhoCorasickMatch = 1;
+
+// Builds an Aho-Corasick automaton for needles and returns its transition
+// table, row-major: the state after `state` on byte b is
+//
+//   table[state * classes.size + classes.of[b]]
+//
+// The failure links are folded into the table, so every byte is exactly one
+// lookup. Empty needles are ignored. The table is a std::vector, so this can
+// also run at compile time as long as the result is copied into an array
+// (see MakeRegexTable in charset.h).
+constexpr std::vector<uint32_t> MakeAhoCorasickDfa(
+    std::span<const std::string_view> needles, const ByteClasses& classes) {
+  constexpr uint32_t kNone = ~uint32_t{0};
+  const size_t width = classes.size;
+
+  // The trie of the needles. A needle's last edge goes straight to the match
+  // state, which also cuts off any longer needle that extends it: that one
+  // can only be seen after this one already has.
+  std::vector<uint32_t> trie(2 * width, kNone);
+  for (std::string_view needle : needles) {
+    uint32_t state = kAhoCorasickStart;
+    for (size_t i = 0; i < needle.size() && state != kAhoCorasickMatch; ++i) {
+      const size_t edge =
+          state * width + classes.of[static_cast<uint8_t>(needle[i])];
+      if (i + 1 == needle.size()) {
+        trie[edge] = kAhoCorasickMatch;
+      } else if (trie[edge] == kNone) {
+        trie[edge] = trie.size() / width;
+        trie.resize(trie.size() + width, kNone);
+      }
+      state = trie[edge];
+    }
+  }
+
+  // Breadth-first, so that when a state is visited, the state its failure
+  // link points to (which is shallower) already has its full row. A state
+  // whose failure link is the match state has a needle as a suffix, so it is
+  // replaced by the match state. The surviving states are renumbered in
+  // visiting order, which keeps the hot, shallow rows together.
+  const size_t num_trie_states = trie.size() / width;
+  std::vector<uint32_t> dfa(trie.size());
+  std::vector<uint32_t> fail(num_trie_states, kAhoCorasickStart);
+  std::vector<uint32_t> id(num_trie_states, kNone);
+  id[kAhoCorasickStart] = kAhoCorasickStart;
+  id[kAhoCorasickMatch] = kAhoCorasickMatch;
+  std::vector<uint32_t> queue = {kAhoCorasickStart};
+  for (size_t q = 0; q < queue.size(); ++q) {
+    const uint32_t state = queue[q];
+    for (size_t c = 0; c < width; ++c) {
+      const uint32_t child = trie[state * width + c];
+      const uint32_t fallback = state == kAhoCorasickStart
+                                    ? kAhoCorasickStart
+                                    : dfa[fail[state] * width + c];
+      uint32_t& next = dfa[state * width + c];
+      if (child == kNone) {
+        next = fallback;
+      } else if (child == kAhoCorasickMatch || fallback == kAhoCorasickMatch) {
+        next = kAhoCorasickMatch;
+      } else {
+        fail[child] = fallback;
+        next = child;
+        id[child] = queue.size() + 1;
+        queue.push_back(child);
+      }
+    }
+  }
+
+  std::vector<uint32_t> table((queue.size() + 1) * width, kAhoCorasickMatch);
+  for (uint32_t state : queue) {
+    for (size_t c = 0; c < width; ++c) {
+      table[id[state] * width + c] = id[dfa[state * width + c]];
+    }
+  }
+  return table;
+}
+
+// An Aho-Corasick DFA over the byte classes of its needles. It costs the same
+// per byte whatever the number of needles, but each step waits on the load of
+// the previous one, and the table outgrows L1 at a few hundred needles.
+class AhoCorasick {
+ public:
+  explicit AhoCorasick(std::span<const std::string_view> needles);
+
+  bool ContainsAny(std::string_view haystack) const;
+
+  size_t num_states() const { return table_.size() / classes_.size; }
+
+ private:
+  ByteClasses classes_;
+  // The table of MakeAhoCorasickDfa with each entry multiplied by the row
+  // width, so that a step is one add and one load.
+  std::vector<uint32_t> table_;
+};
+
+// Teddy, from Hyperscan: a vector prefilter for tens of needles. The needles
+// are spread over 8 buckets, and for each of their first prefix() bytes there
+// is a pair of NibbleTables whose bit b says "some needle in bucket b can
+// have this byte here". Classifying a vector of the haystack once per prefix
+// byte, shifting, and and-ing the results gives, for each position, the
+// buckets whose needles may start there; only those are compared in full. As
+// the needle count grows, more positions pass the filter and each bucket has
+// more needles to compare, so past kMaxNeedles this is just AhoCorasick.
+class Teddy {
+ public:
+  static constexpr size_t kMaxNeedles = 32;
+
+  explicit Teddy(std::span<const std::string_view> needles);
+
+  bool ContainsAny(std::string_view haystack) const;
+
+  // How many leading bytes of each needle the filter looks at: the length of
+  // the shortest needle, up to 3, or 0 if the filter is not used.
+  int prefix() const { return prefix_; }
+
+ private:
+  static constexpr int kNumBuckets = 8;
+
+  // Returns whether a needle from one of the buckets in `buckets` occurs at
+  // haystack[pos].
+  bool Verify(std::string_view haystack, size_t pos, uint8_t buckets) const;
+
+  // The vector kernels, defined in multisearch.cc.
+  friend struct TeddyKernels;
+
+  std::vector<std::string> needles_;
+  std::array<std::vector<uint32_t>, kNumBuckets> buckets_;
+  std::array<NibbleTables, 3> masks_;
+  int prefix_ = 0;
+  // The vector kernel for prefix_, or nullptr if the CPU has none or there are
+  // too many needles.
+  bool (*scan_)(const Teddy&, std::string_view) = nullptr;
+  // For haystacks shorter than a vector, and CPUs without one.
+  AhoCorasick fallback_;
+};
+
+}  // namespace charscan
+
+#endif  // MULTISEARCH_H_
@@ -0,0 +1,124 @@
+#include "multisearch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace charscan {
+namespace {
+
+bool ContainsAnyReference(std::string_view haystack,
+                          const std::vector<std::string_view>& needles) {
+  return std::any_of(needles.begin(), needles.end(), [&](std::string_view n) {
+    return haystack.find(n) != std::string_view::npos;
+  });
+}
+
+// Needles drawn from few bytes, so that random haystacks match some of the
+// time, and with bytes above 0x80, which Teddy's nibble tables must tell
+// apart from the ASCII ones with the same low nibble.
+constexpr std::string_view kNeedleBytes = "abc\xe1\xe2";
+// Never in a needle.
+constexpr char kFiller = 'q';
+
+std::string RandomString(std::mt19937& rng, size_t length,
+                         std::string_view bytes) {
+  std::uniform_int_distribution<size_t> byte(0, bytes.size() - 1);
+  std::string s(length, '\0');
+  for (char& c : s) c = bytes[byte(rng)];
+  return s;
+}
+
+struct NeedleSet {
+  std::vector<std::string> storage;
+  std::vector<std::string_view> needles;
+};
+
+// num_needles needles of min_length to max_length bytes.
+NeedleSet MakeNeedles(std::mt19937& rng, size_t num_needles, size_t min_length,
+                      size_t max_length) {
+  std::uniform_int_distribution<size_t> length(min_length, max_length);
+  NeedleSet set;
+  for (size_t i = 0; i < num_needles; ++i) {
+    set.storage.push_back(RandomString(rng, length(rng), kNeedleBytes));
+  }
+  set.needles.assign(set.storage.begin(), set.storage.end());
+  return set;
+}
+
+// Every haystack length around one 16-byte vector and a few beyond, random
+// (so matches come anywhere, or nowhere), and with a single needle planted in
+// filler at every position.
+std::vector<std::string> Haystacks(std::mt19937& rng, const NeedleSet& set) {
+  std::vector<std::string> haystacks;
+  std::vector<size_t> lengths;
+  for (size_t length = 0; length <= 40; ++length) lengths.push_back(length);
+  for (size_t length : {63, 64, 65, 100, 1000}) lengths.push_back(length);
+  for (size_t length : lengths) {
+    haystacks.push_back(RandomString(rng, length, "abcdxyz\xe1\x61\xf1"));
+    haystacks.emplace_back(length, kFiller);
+  }
+  const std::string_view needle = set.needles.front();
+  for (size_t length : {8, 15, 16, 17, 33, 100}) {
+    for (size_t pos = 0; pos + needle.size() <= length; ++pos) {
+      std::string s(length, kFiller);
+      s.replace(pos, needle.size(), needle);
+      haystacks.push_back(s);
+    }
+  }
+  return haystacks;
+}
+
+// 1 and 32 needles take Teddy's vector kernels, 33 its fallback; lengths 1 to
+// 3 are each a different prefix(), and 4 and 5 verify past the prefix.
+TEST(MultiSearch, MatchesReference) {
+  std::mt19937 rng(20);
+  for (size_t num_needles : {1, 2, 8, 32, 33}) {
+    for (size_t min_length = 1; min_length <= 5; ++min_length) {
+      for (size_t max_length : {min_length, size_t{5}}) {
+        const NeedleSet set =
+            MakeNeedles(rng, num_needles, min_length, max_length);
+        const AhoCorasick aho_corasick(set.needles);
+        const Teddy teddy(set.needles);
+        size_t shortest = max_length;
+        for (std::string_view needle : set.needles) {
+          shortest = std::min(shortest, needle.size());
+        }
+        EXPECT_EQ(teddy.prefix(), num_needles <= Teddy::kMaxNeedles
+                                      ? std::min<size_t>(shortest, 3)
+                                      : 0);
+        for (const std::string& haystack : Haystacks(rng, set)) {
+          const bool expected = ContainsAnyReference(haystack, set.needles);
+          ASSERT_EQ(aho_corasick.ContainsAny(haystack), expected)
+              << num_needles << " needles of " << min_length << "-"
+              << max_length << " bytes in \"" << haystack << "\"";
+          ASSERT_EQ(teddy.ContainsAny(haystack), expected)
+              << num_needles << " needles of " << min_length << "-"
+              << max_length << " bytes in \"" << haystack << "\"";
+        }
+      }
+    }
+  }
+}
+
+// Empty needles are ignored rather than matching everywhere.
+TEST(MultiSearch, EmptyNeedles) {
+  const std::vector<std::string_view> needles = {"", "abc"};
+  const AhoCorasick aho_corasick(needles);
+  const Teddy teddy(needles);
+  for (std::string_view haystack :
+       {std::string_view(""), std::string_view("xxxxxxxxxxxxxxxxxxxxab"),
+        std::string_view("xxxxxxxxxxxxxxxxxxxxabc")}) {
+    const bool expected = haystack.find("abc") != std::string_view::npos;
+    EXPECT_EQ(aho_corasick.ContainsAny(haystack), expected) << haystack;
+    EXPECT_EQ(teddy.ContainsAny(haystack), expected) << haystack;
+  }
+}
+
+}  // namespace
+}  // namespace charscan
@@ -0,0 +1,227 @@
+// End-to-end throughput of scanning a file through the pipeline in
+// pipeline.h, against the same kernel on data that is already in memory. The
+// gap between the two is the cost of I/O that the pipeline fails to hide.
+//
+//   bazel run -c opt :pipeline-benchmark_test -- --pipeline_file=/nvme/big.log
+//
+// Without --pipeline_file a file of vowel-free text is generated in
+// $TEST_TMPDIR, so that every kernel reads every byte. The cold benchmarks
+// evict the file from the page cache before each iteration, so they measure
+// the disk; the warm ones measure the page cache.
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <deque>
+#include <future>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "benchmark/benchmark.h"
+#include "charscan.h"
+#include "corpus.h"
+#include "pipeline.h"
+#include "vowels.h"
+
+ABSL_FLAG(std::string, pipeline_file, "",
+          "File to scan. If empty, one is generated in $TEST_TMPDIR.");
+ABSL_FLAG(uint64_t, pipeline_file_mib, 512,
+          "Size of the generated file, in MiB.");
+
+// Writes a file of random vowel-free lines. One random 1 MiB chunk is
+// repeated, since the content only matters to the kernels, not to the disk.
+static std::string GenerateFile(size_t mib) {
+  const char* tmpdir = std::getenv("TEST_TMPDIR");
+  std::string path = std::string(tmpdir != nullptr ? tmpdir : "/tmp") +
+                     "/pipeline-benchmark-XXXXXX";
+  const int fd = mkstemp(path.data());
+  if (fd < 0) {
+    std::perror("mkstemp");
+    std::abort();
+  }
+
+  // The same bytes as the vowel-free corpora of vowels-benchmark_test, in
+  // lines of 1 to 200 of them.
+  std::string chunk(1 << 20, '\0');
+  charscan::FillRandom(/*seed=*/42, /*vowel_probability=*/0, chunk);
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<> line_dist(1, 200);
+  for (size_t i = line_dist(rng); i < chunk.size(); i += line_dist(rng) + 1) {
+    chunk[i] = '\n';
+  }
+  chunk.back() = '\n';
+  for (size_t i = 0; i < mib; ++i) {
+    if (write(fd, chunk.data(), chunk.size()) !=
+        static_cast<ssize_t>(chunk.size())) {
+      std::perror(path.c_str());
+      std::abort();
+    }
+  }
+  close(fd);
+  return path;
+}
+
+// The file under test. A generated file is removed again at exit.
+static const std::string& FilePath() {
+  static const std::string* path = [] {
+    std::string flag = absl::GetFlag(FLAGS_pipeline_file);
+    if (!flag.empty()) return new std::string(flag);
+    auto* generated =
+        new std::string(GenerateFile(absl::GetFlag(FLAGS_pipeline_file_mib)));
+    std::atexit([] { std::remove(FilePath().c_str()); });
+    return generated;
+  }();
+  return *path;
+}
+
+// Scans every block the reader produces on workers, with at most
+// max_in_flight blocks outstanding. Returns the number of bytes scanned.
+static int64_t ScanBlocks(charscan::LineBlockReader& reader,
+                          charscan::BlockPool& blocks,
+                          charscan::ThreadPool& workers,
+                          size_t max_in_flight) {
+  int64_t bytes = 0;
+  int64_t hits = 0;
+  std::deque<std::future<bool>> pending;
+  while (std::optional<charscan::Block> block = reader.Next()) {
+    bytes += block->size;
+    pending.push_back(
+        workers.Submit([&blocks, block = *std::move(block)]() mutable {
+          bool hit = charscan::HasAnyOfNibble(block.text(),
+                                              charscan::kVowelNibbleTables);
+          blocks.Put(std::move(block));
+          return hit;
+        }));
+    while (pending.size() > max_in_flight) {
+      hits += pending.front().get();
+      pending.pop_front();
+    }
+  }
+  for (std::future<bool>& hit : pending) hits += hit.get();
+  benchmark::DoNotOptimize(hits);
+  return bytes;
+}
+
+// Runs body once per iteration, evicting the file from the page cache first
+// if the benchmark is cold, and reports the file's size as bytes processed.
+template <typename Body>
+static void RunFileIterations(benchmark::State& state, bool cold, Body body) {
+  const std::string& path = FilePath();
+  int64_t bytes = 0;
+  for (auto _ : state) {
+    if (cold) {
+      state.PauseTiming();
+      const bool evicted = charscan::EvictFromPageCache(path);
+      state.ResumeTiming();
+      if (!evicted) {
+        state.SkipWithError("cannot evict the file from the page cache");
+        return;
+      }
+    }
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+      state.SkipWithError("cannot open the file");
+      return;
+    }
+    bytes += body(fd);
+    close(fd);
+  }
+  state.SetBytesProcessed(bytes);
+}
+
+// The I/O ceiling: the reader alone, with every block recycled unscanned.
+static void BM_Read(benchmark::State& state) {
+  charscan::BlockPool blocks(state.range(0));
+  RunFileIterations(state, state.range(1) != 0, [&](int fd) {
+    charscan::LineBlockReader reader(fd, blocks, /*max_ready=*/4);
+    int64_t bytes = 0;
+    while (std::optional<charscan::Block> block = reader.Next()) {
+      bytes += block->size;
+      blocks.Put(*std::move(block));
+    }
+    return bytes;
+  });
+}
+
+BENCHMARK(BM_Read)
+    ->ArgNames({"block", "cold"})
+    ->ArgsProduct({{256 << 10, 1 << 20, 4 << 20}, {0, 1}})
+    ->UseRealTime();
+
+// The whole pipeline: the reader fills block N+1 while the workers scan
+// blocks N and before.
+static void BM_Pipeline(benchmark::State& state) {
+  const int num_workers = state.range(1);
+  const size_t max_in_flight = 2 * num_workers;
+  charscan::BlockPool blocks(state.range(0));
+  charscan::ThreadPool workers(num_workers);
+  RunFileIterations(state, state.range(2) != 0, [&](int fd) {
+    charscan::LineBlockReader reader(fd, blocks, max_in_flight);
+    return ScanBlocks(reader, blocks, workers, max_in_flight);
+  });
+}
+
+BENCHMARK(BM_Pipeline)
+    ->ArgNames({"block", "workers", "cold"})
+    ->ArgsProduct({{256 << 10, 1 << 20, 4 << 20}, {1, 2, 4}, {0, 1}})
+    ->UseRealTime();
+
+// The kernel alone, on the file's contents already in memory, split into
+// the same blocks and spread over the same workers.
+static void BM_InMemory(benchmark::State& state) {
+  static const std::string* contents = [] {
+    auto* contents = new std::string;
+    const int fd = open(FilePath().c_str(), O_RDONLY);
+    std::string buffer(1 << 20, '\0');
+    for (ssize_t n; (n = read(fd, buffer.data(), buffer.size())) > 0;) {
+      contents->append(buffer, 0, n);
+    }
+    close(fd);
+    return contents;
+  }();
+
+  const size_t block_size = state.range(0);
+  const int num_workers = state.range(1);
+  charscan::ThreadPool workers(num_workers);
+  for (auto _ : state) {
+    std::deque<std::future<bool>> pending;
+    int64_t hits = 0;
+    for (size_t pos = 0; pos < contents->size(); pos += block_size) {
+      const std::string_view block =
+          std::string_view(*contents).substr(pos, block_size);
+      pending.push_back(workers.Submit([block] {
+        return charscan::HasAnyOfNibble(block, charscan::kVowelNibbleTables);
+      }));
+      while (pending.size() > 2 * static_cast<size_t>(num_workers)) {
+        hits += pending.front().get();
+        pending.pop_front();
+      }
+    }
+    for (std::future<bool>& hit : pending) hits += hit.get();
+    benchmark::DoNotOptimize(hits);
+  }
+  state.SetBytesProcessed(state.iterations() * contents->size());
+}
+
+BENCHMARK(BM_InMemory)
+    ->ArgNames({"block", "workers"})
+    ->ArgsProduct({{256 << 10, 1 << 20, 4 << 20}, {1, 2, 4}})
+    ->UseRealTime();
+
+// Not benchmark_main: the flags above have to be parsed after
+// google_benchmark has removed its own.
+int main(int argc, char** argv) {
+  benchmark::Initialize(&argc, argv);
+  absl::ParseCommandLine(argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
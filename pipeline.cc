@@ -0,0 +1,197 @@
+#include "pipeline.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace charscan {
+
+Block::Block(size_t capacity)
+    : capacity_(RoundUpToBlockAlignment(capacity)),
+      data_(static_cast<char*>(
+          std::aligned_alloc(kBlockAlignment, capacity_))) {
+  if (data_ == nullptr) {
+    std::perror("aligned_alloc");
+    std::abort();
+  }
+}
+
+void Block::Free::operator()(char* data) const { std::free(data); }
+
+Block BlockPool::Get() {
+  {
+    std::lock_guard lock(mutex_);
+    if (!free_.empty()) {
+      Block block = std::move(free_.back());
+      free_.pop_back();
+      block.size = 0;
+      return block;
+    }
+  }
+  return Block(block_size_);
+}
+
+void BlockPool::Put(Block block) {
+  if (block.capacity() != block_size_) return;
+  std::lock_guard lock(mutex_);
+  free_.push_back(std::move(block));
+}
+
+ThreadPool::ThreadPool(int num_threads) {
+  for (int i = 0; i < num_threads; ++i) {
+    threads_.emplace_back([this] { Work(); });
+  }
+}
+
+ThreadPool::~ThreadPool() {
+  {
+    std::lock_guard lock(mutex_);
+    done_ = true;
+  }
+  ready_.notify_all();
+  for (std::thread& thread : threads_) {
+    thread.join();
+  }
+}
+
+void ThreadPool::Work() {
+  for (;;) {
+    std::function<void()> task;
+    {
+      std::unique_lock lock(mutex_);
+      ready_.wait(lock, [&] { return done_ || !tasks_.empty(); });
+      if (tasks_.empty()) return;
+      task = std::move(tasks_.front());
+      tasks_.pop_front();
+    }
+    task();
+  }
+}
+
+// Reads up to size bytes, stopping early only at the end of the input.
+static ssize_t ReadFull(int fd, char* data, size_t size) {
+  size_t total = 0;
+  while (total < size) {
+    ssize_t n = read(fd, data + total, size - total);
+    if (n < 0) {
+      if (errno == EINTR) continue;
+      return -1;
+    }
+    if (n == 0) break;
+    total += n;
+  }
+  return total;
+}
+
+LineBlockReader::LineBlockReader(int fd, BlockPool& pool, size_t max_ready)
+    : fd_(fd),
+      pool_(pool),
+      max_ready_(std::max<size_t>(max_ready, 1)),
+      thread_([this] { Read(); }) {}
+
+LineBlockReader::~LineBlockReader() {
+  {
+    std::lock_guard lock(mutex_);
+    stopping_ = true;
+  }
+  changed_.notify_all();
+  thread_.join();
+}
+
+std::optional<Block> LineBlockReader::Next() {
+  std::unique_lock lock(mutex_);
+  changed_.wait(lock, [&] { return done_ || !ready_.empty(); });
+  if (ready_.empty()) return std::nullopt;
+  Block block = std::move(ready_.front());
+  ready_.pop_front();
+  lock.unlock();
+  changed_.notify_all();
+  return block;
+}
+
+bool LineBlockReader::Push(Block block) {
+  {
+    std::unique_lock lock(mutex_);
+    changed_.wait(lock,
+                  [&] { return stopping_ || ready_.size() < max_ready_; });
+    if (stopping_) return false;
+    ready_.push_back(std::move(block));
+  }
+  changed_.notify_all();
+  return true;
+}
+
+void LineBlockReader::Read() {
+#ifdef POSIX_FADV_SEQUENTIAL
+  posix_fadvise(fd_, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+  int error = 0;
+  Block block = pool_.Get();
+  for (;;) {
+    ssize_t n = ReadFull(fd_, block.data() + block.size,
+                         block.capacity() - block.size);
+    if (n < 0) {
+      error = errno;
+    } else {
+      block.size += n;
+    }
+    if (n <= 0 || block.size < block.capacity()) {
+      if (block.size > 0) {
+        Push(std::move(block));
+      } else {
+        pool_.Put(std::move(block));
+      }
+      break;
+    }
+
+    const size_t line_end = block.text().rfind('\n');
+    if (line_end == std::string_view::npos) {
+      // A single line fills the whole block.
+      Block bigger(2 * block.capacity());
+      std::memcpy(bigger.data(), block.data(), block.size);
+      bigger.size = block.size;
+      block = std::move(bigger);
+      continue;
+    }
+    // The partial last line moves to the start of the next block, which must
+    // have room to read more after it.
+    const size_t tail = block.size - (line_end + 1);
+    Block next = tail < pool_.block_size() ? pool_.Get() : Block(2 * tail);
+    next.size = tail;
+    std::memcpy(next.data(), block.data() + line_end + 1, next.size);
+    block.size = line_end + 1;
+    if (!Push(std::move(block))) return;
+    block = std::move(next);
+  }
+
+  {
+    std::lock_guard lock(mutex_);
+    error_ = error;
+    done_ = true;
+  }
+  changed_.notify_all();
+}
+
+bool EvictFromPageCache(const std::string& path) {
+#ifdef POSIX_FADV_DONTNEED
+  const int fd = open(path.c_str(), O_RDONLY);
+  if (fd < 0) return false;
+  const bool evicted = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+  close(fd);
+  return evicted;
+#else
+  return false;
+#endif
+}
+
+}  // namespace charscan
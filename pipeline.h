@@ -0,0 +1,151 @@
+// Building blocks for scanning input that does not fit in memory: aligned,
+// recycled buffers, a thread pool, and a reader thread that fills the next
+// buffer while the current ones are being scanned.
+
+#ifndef PIPELINE_H_
+#define PIPELINE_H_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace charscan {
+
+// Buffers are aligned for the page cache and for the kernels' vector loads.
+inline constexpr size_t kBlockAlignment = 4096;
+
+constexpr size_t RoundUpToBlockAlignment(size_t size) {
+  return (size + kBlockAlignment - 1) / kBlockAlignment * kBlockAlignment;
+}
+
+// A buffer of input. The capacity is rounded up to kBlockAlignment; size is
+// how much of it holds data.
+class Block {
+ public:
+  explicit Block(size_t capacity);
+
+  char* data() { return data_.get(); }
+  size_t capacity() const { return capacity_; }
+  std::string_view text() const { return {data_.get(), size}; }
+
+  size_t size = 0;
+
+ private:
+  struct Free {
+    void operator()(char* data) const;
+  };
+
+  size_t capacity_;
+  std::unique_ptr<char, Free> data_;
+};
+
+// Hands out blocks of a fixed capacity and takes them back once they have
+// been scanned, so that the steady state does not allocate. Thread-safe.
+class BlockPool {
+ public:
+  explicit BlockPool(size_t block_size)
+      : block_size_(RoundUpToBlockAlignment(block_size)) {}
+
+  size_t block_size() const { return block_size_; }
+
+  // Returns an empty block of block_size() bytes.
+  Block Get();
+
+  // Blocks of any other capacity (e.g. grown for a long line) are freed.
+  void Put(Block block);
+
+ private:
+  const size_t block_size_;
+  std::mutex mutex_;
+  std::vector<Block> free_;
+};
+
+// A fixed set of threads running tasks in the order they were submitted.
+class ThreadPool {
+ public:
+  explicit ThreadPool(int num_threads);
+  ~ThreadPool();
+
+  template <typename F>
+  std::future<std::invoke_result_t<F>> Submit(F f) {
+    // std::function needs a copyable target, so the move-only task goes
+    // behind a shared_ptr.
+    auto task = std::make_shared<std::packaged_task<std::invoke_result_t<F>()>>(
+        std::move(f));
+    auto result = task->get_future();
+    {
+      std::lock_guard lock(mutex_);
+      tasks_.push_back([task] { (*task)(); });
+    }
+    ready_.notify_one();
+    return result;
+  }
+
+ private:
+  void Work();
+
+  std::mutex mutex_;
+  std::condition_variable ready_;
+  std::deque<std::function<void()>> tasks_;
+  bool done_ = false;
+  std::vector<std::thread> threads_;
+};
+
+// Reads fd to the end on its own thread, into blocks that end on a line
+// boundary (or at the end of the input). A block grows when a single line
+// does not fit. At most max_ready blocks are read ahead of the consumer, so
+// a slow consumer stalls the reader instead of growing the pool.
+class LineBlockReader {
+ public:
+  LineBlockReader(int fd, BlockPool& pool, size_t max_ready);
+  ~LineBlockReader();
+
+  LineBlockReader(const LineBlockReader&) = delete;
+  LineBlockReader& operator=(const LineBlockReader&) = delete;
+
+  // Returns the next block, or std::nullopt once the input is exhausted.
+  std::optional<Block> Next();
+
+  // The errno of a failed read, or 0. Only meaningful once Next() has
+  // returned std::nullopt; the blocks before the failure are still returned.
+  int error() const { return error_; }
+
+ private:
+  void Read();
+  // Returns false if the reader is being shut down.
+  bool Push(Block block);
+
+  const int fd_;
+  BlockPool& pool_;
+  const size_t max_ready_;
+
+  std::mutex mutex_;
+  std::condition_variable changed_;
+  std::deque<Block> ready_;
+  bool done_ = false;
+  bool stopping_ = false;
+  int error_ = 0;
+
+  // Last, so that it starts after everything it uses is initialized.
+  std::thread thread_;
+};
+
+// Drops path's pages from the page cache, so that the next read of it goes to
+// the disk. Pages that are mapped or dirty are kept. Returns false where this
+// isn't supported.
+bool EvictFromPageCache(const std::string& path);
+
+}  // namespace charscan
+
+#endif  // PIPELINE_H_
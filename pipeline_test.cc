@@ -0,0 +1,231 @@
+#include "pipeline.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <future>
+#include <optional>
+#include <random>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+namespace charscan {
+namespace {
+
+// A file holding contents, removed again on destruction.
+class TempFile {
+ public:
+  explicit TempFile(std::string_view contents) {
+    const char* tmpdir = std::getenv("TEST_TMPDIR");
+    path_ = std::string(tmpdir != nullptr ? tmpdir : "/tmp") +
+            "/pipeline_test-XXXXXX";
+    const int fd = mkstemp(path_.data());
+    EXPECT_GE(fd, 0);
+    EXPECT_EQ(write(fd, contents.data(), contents.size()),
+              static_cast<ssize_t>(contents.size()));
+    close(fd);
+  }
+  ~TempFile() { std::remove(path_.c_str()); }
+
+  int Open() const { return open(path_.c_str(), O_RDONLY); }
+
+ private:
+  std::string path_;
+};
+
+std::vector<std::string> ReadBlocks(int fd, size_t block_size,
+                                    size_t max_ready, int* error = nullptr) {
+  BlockPool pool(block_size);
+  LineBlockReader reader(fd, pool, max_ready);
+  std::vector<std::string> blocks;
+  while (std::optional<Block> block = reader.Next()) {
+    blocks.emplace_back(block->text());
+    pool.Put(*std::move(block));
+  }
+  if (error != nullptr) *error = reader.error();
+  return blocks;
+}
+
+// Lines of 0 to max_line bytes, the last of them with or without a newline.
+std::string RandomLines(std::mt19937& rng, size_t size, size_t max_line,
+                        bool final_newline) {
+  std::uniform_int_distribution<size_t> line(0, max_line);
+  std::string s;
+  while (s.size() < size) {
+    s.append(line(rng), 'x');
+    s += '\n';
+  }
+  if (!final_newline) s += "last";
+  return s;
+}
+
+void ExpectLineBlocks(const std::vector<std::string>& blocks,
+                      std::string_view contents, size_t block_size) {
+  std::string joined;
+  for (size_t i = 0; i < blocks.size(); ++i) {
+    EXPECT_FALSE(blocks[i].empty()) << "block " << i;
+    if (i + 1 < blocks.size()) {
+      EXPECT_TRUE(blocks[i].ends_with('\n'))
+          << "block " << i << " of " << blocks.size();
+    }
+    joined += blocks[i];
+  }
+  EXPECT_EQ(joined, contents) << "block size " << block_size;
+}
+
+TEST(LineBlockReader, BlocksEndOnLineBoundaries) {
+  std::mt19937 rng(14);
+  for (size_t block_size : {4096, 8192, 65536}) {
+    std::vector<std::string> inputs = {
+        "",
+        "\n",
+        "no newline",
+        std::string(3 * block_size, '\n'),
+        // Exactly one block, and one byte more.
+        std::string(block_size - 1, 'x') + "\n",
+        std::string(block_size, 'x') + "\n",
+        // A line longer than a block between short ones, and one that is
+        // the whole input.
+        "a\n" + std::string(3 * block_size + 5, 'x') + "\nb\n",
+        std::string(2 * block_size + 7, 'x'),
+    };
+    for (bool final_newline : {true, false}) {
+      inputs.push_back(RandomLines(rng, 10 * block_size, 200, final_newline));
+      inputs.push_back(
+          RandomLines(rng, 10 * block_size, 2 * block_size, final_newline));
+    }
+    for (const std::string& contents : inputs) {
+      for (size_t max_ready : {1, 4}) {
+        const TempFile file(contents);
+        const int fd = file.Open();
+        ASSERT_GE(fd, 0);
+        int error = -1;
+        ExpectLineBlocks(ReadBlocks(fd, block_size, max_ready, &error),
+                         contents, block_size);
+        EXPECT_EQ(error, 0);
+        close(fd);
+      }
+    }
+  }
+}
+
+// A pipe returns short reads, which must not end a block early.
+TEST(LineBlockReader, ShortReads) {
+  std::mt19937 rng(15);
+  const std::string contents = RandomLines(rng, 1 << 20, 300, false);
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  std::thread writer([&] {
+    for (size_t pos = 0; pos < contents.size(); pos += 1000) {
+      const std::string_view piece =
+          std::string_view(contents).substr(pos, 1000);
+      ASSERT_EQ(write(fds[1], piece.data(), piece.size()),
+                static_cast<ssize_t>(piece.size()));
+    }
+    close(fds[1]);
+  });
+  ExpectLineBlocks(ReadBlocks(fds[0], 8192, 2), contents, 8192);
+  writer.join();
+  close(fds[0]);
+}
+
+TEST(LineBlockReader, ReadErrors) {
+  int error = 0;
+  EXPECT_TRUE(ReadBlocks(-1, 4096, 1, &error).empty());
+  EXPECT_EQ(error, EBADF);
+
+  // A directory can be opened, but not read.
+  const char* tmpdir = std::getenv("TEST_TMPDIR");
+  const int fd = open(tmpdir != nullptr ? tmpdir : "/tmp", O_RDONLY);
+  ASSERT_GE(fd, 0);
+  EXPECT_TRUE(ReadBlocks(fd, 4096, 1, &error).empty());
+  EXPECT_EQ(error, EISDIR);
+  close(fd);
+}
+
+// With nobody calling Next(), the reader stops after max_ready blocks (and
+// the one it is filling), so the writer of a pipe gets only a little ahead.
+TEST(LineBlockReader, MaxReadyBoundsReadAhead) {
+  static constexpr size_t kBlockSize = 64 << 10;
+  static constexpr size_t kMaxReady = 2;
+  const std::string line(1023, 'x');
+  // The writer may still be blocked in write() when the read end closes.
+  std::signal(SIGPIPE, SIG_IGN);
+  int fds[2];
+  ASSERT_EQ(pipe(fds), 0);
+  std::atomic<size_t> written = 0;
+  std::atomic<bool> stop = false;
+  std::thread writer([&] {
+    while (!stop) {
+      const std::string piece = line + "\n";
+      if (write(fds[1], piece.data(), piece.size()) !=
+          static_cast<ssize_t>(piece.size())) {
+        break;
+      }
+      written += piece.size();
+    }
+    close(fds[1]);
+  });
+  {
+    BlockPool pool(kBlockSize);
+    LineBlockReader reader(fds[0], pool, kMaxReady);
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    // The pipe's own buffer is at most a few blocks on Linux.
+    EXPECT_LE(written.load(), (kMaxReady + 1 + 4) * kBlockSize);
+    EXPECT_TRUE(reader.Next().has_value());
+    // Destroying the reader while it waits for room must not hang.
+    stop = true;
+  }
+  close(fds[0]);
+  writer.join();
+}
+
+TEST(BlockPool, RecyclesBlocksOfItsSize) {
+  BlockPool pool(5000);
+  EXPECT_EQ(pool.block_size(), 8192);
+  Block block = pool.Get();
+  EXPECT_EQ(block.capacity(), 8192);
+  EXPECT_EQ(reinterpret_cast<uintptr_t>(block.data()) % kBlockAlignment, 0);
+  const char* data = block.data();
+  block.size = 100;
+  pool.Put(std::move(block));
+  Block again = pool.Get();
+  EXPECT_EQ(again.data(), data);
+  EXPECT_EQ(again.size, 0);
+
+  // A grown block is freed rather than handed out again.
+  pool.Put(Block(3 * 8192));
+  EXPECT_EQ(pool.Get().capacity(), 8192);
+}
+
+TEST(ThreadPool, RunsEveryTask) {
+  std::vector<std::future<int>> results;
+  std::atomic<int> ran = 0;
+  {
+    ThreadPool pool(3);
+    for (int i = 0; i < 100; ++i) {
+      results.push_back(pool.Submit([i, &ran] {
+        ++ran;
+        return i * i;
+      }));
+    }
+    for (int i = 0; i < 50; ++i) EXPECT_EQ(results[i].get(), i * i);
+  }
+  // The destructor finishes the tasks still queued.
+  EXPECT_EQ(ran, 100);
+  for (int i = 50; i < 100; ++i) EXPECT_EQ(results[i].get(), i * i);
+}
+
+}  // namespace
+}  // namespace charscan
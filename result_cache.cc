@@ -0,0 +1,131 @@
+#include "result_cache.h"
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace charscan {
+
+ResultCache::ResultCache(Kernel kernel, size_t slots)
+    : kernel_(kernel),
+      mask_(std::bit_ceil(std::max(slots, kProbes)) - 1),
+      slots_(std::make_unique<Slot[]>(mask_ + 1)) {}
+
+// The n < 8 bytes at p in the low bytes of a word, from loads that stay
+// within them: two overlapping 4-byte loads, or the first, middle and last
+// byte, as in wyhash.
+static uint64_t LoadPartialWord(const char* p, size_t n) {
+  if (n >= 4) {
+    uint32_t low, high;
+    std::memcpy(&low, p, sizeof(low));
+    std::memcpy(&high, p + n - 4, sizeof(high));
+    return low | uint64_t{high} << (8 * (n - 4));
+  }
+  if (n == 0) {
+    return 0;
+  }
+  return uint64_t{static_cast<uint8_t>(p[0])} |
+         uint64_t{static_cast<uint8_t>(p[n / 2])} << (8 * (n / 2)) |
+         uint64_t{static_cast<uint8_t>(p[n - 1])} << (8 * (n - 1));
+}
+
+// Each pair of words is folded with one 64x64->128-bit multiply, as in
+// wyhash, and the products are combined with XOR, so the multiplies do not
+// wait on each other; then the SplitMix64 finalizer, so that the low bits,
+// which pick the slot, depend on every byte. The padding is hashed and
+// compared too, so the loops have a fixed trip count and do not mispredict on
+// keys of mixed lengths.
+ResultCache::Key ResultCache::Pack(std::string_view key) {
+  static constexpr uint64_t kSecret[kKeyWords] = {
+      0xa0761d6478bd642f, 0xe7037ed1a0b428db, 0x8ebc6af09c88c6e3,
+      0x589965cc75374cc3, 0x1d8e4e27c47d124f, 0x9e3779b97f4a7c15,
+  };
+  // Not one memcpy of the whole key: the word loads below would then read
+  // back several smaller stores each, which on x86 stalls store forwarding.
+  Key packed = {};
+  const size_t full_words = key.size() / sizeof(uint64_t);
+  for (size_t w = 0; w < full_words; ++w) {
+    std::memcpy(&packed.words[w], key.data() + w * sizeof(uint64_t),
+                sizeof(uint64_t));
+  }
+  if (full_words < kKeyWords) {
+    packed.words[full_words] =
+        LoadPartialWord(key.data() + full_words * sizeof(uint64_t),
+                        key.size() % sizeof(uint64_t));
+  }
+  uint64_t h = key.size();
+  for (size_t w = 0; w < kKeyWords; w += 2) {
+    const unsigned __int128 product =
+        static_cast<unsigned __int128>(packed.words[w] ^ kSecret[w]) *
+        (packed.words[w + 1] ^ kSecret[w + 1]);
+    h ^= static_cast<uint64_t>(product) ^ static_cast<uint64_t>(product >> 64);
+  }
+  h = (h ^ (h >> 30)) * 0xbf58476d1ce4e5b9;
+  h = (h ^ (h >> 27)) * 0x94d049bb133111eb;
+  packed.hash = h ^ (h >> 31);
+  packed.meta = (packed.hash & ~uint64_t{0xffffffff}) | (key.size() + 1);
+  return packed;
+}
+
+std::optional<bool> ResultCache::Lookup(const Key& key) const {
+  for (size_t probe = 0; probe < kProbes; ++probe) {
+    const Slot& slot = slots_[(key.hash + probe) & mask_];
+    const uint64_t sequence = slot.sequence.load(std::memory_order_acquire);
+    if (sequence % 2 == 1) {
+      continue;
+    }
+    const uint64_t meta = slot.meta.load(std::memory_order_relaxed);
+    // Slots are never emptied, and Insert takes the first empty one, so the
+    // key is not further along.
+    if (meta == 0) {
+      return std::nullopt;
+    }
+    if ((meta & ~kResultBit) != key.meta) {
+      continue;
+    }
+    bool same = true;
+    for (size_t w = 0; w < kKeyWords; ++w) {
+      same &= slot.words[w].load(std::memory_order_relaxed) == key.words[w];
+    }
+    std::atomic_thread_fence(std::memory_order_acquire);
+    if (same && slot.sequence.load(std::memory_order_relaxed) == sequence) {
+      return (meta & kResultBit) != 0;
+    }
+  }
+  return std::nullopt;
+}
+
+void ResultCache::Insert(const Key& key, bool result) {
+  // The first empty slot, or the key's own if it was inserted meanwhile, or
+  // else one picked by the hash bits that neither the slot nor the tag use.
+  Slot* target = &slots_[(key.hash + (key.hash >> 24) % kProbes) & mask_];
+  for (size_t probe = 0; probe < kProbes; ++probe) {
+    Slot& slot = slots_[(key.hash + probe) & mask_];
+    const uint64_t meta = slot.meta.load(std::memory_order_relaxed);
+    if (meta == 0 || (meta & ~kResultBit) == key.meta) {
+      target = &slot;
+      break;
+    }
+  }
+  uint64_t sequence = target->sequence.load(std::memory_order_relaxed);
+  if (sequence % 2 == 1 ||
+      !target->sequence.compare_exchange_strong(sequence, sequence + 1,
+                                                std::memory_order_relaxed)) {
+    return;
+  }
+  std::atomic_thread_fence(std::memory_order_release);
+  for (size_t w = 0; w < kKeyWords; ++w) {
+    target->words[w].store(key.words[w], std::memory_order_relaxed);
+  }
+  target->meta.store(key.meta | (result ? kResultBit : 0),
+                     std::memory_order_relaxed);
+  target->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+}  // namespace charscan
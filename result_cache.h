@@ -0,0 +1,101 @@
+// A memo of a kernel's answers for strings that repeat, e.g. the same short
+// keys over and over: a fixed-size open-addressing table from string to bool
+// that many threads can read and fill at once.
+//
+// Each slot is one cache line holding the key itself, so a hit is exact and
+// costs a hash, one or two cache lines, and a few word compares; keys longer
+// than kMaxKeyBytes always go straight to the kernel. The slots are
+// seqlocked: readers take no lock and write nothing, and retry nothing
+// either. A read that overlaps a write to its slot counts as a miss, and a
+// write that finds its slot being written gives up, since either way the
+// caller already has the answer.
+
+#ifndef RESULT_CACHE_H_
+#define RESULT_CACHE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <string_view>
+
+namespace charscan {
+
+class ResultCache {
+ public:
+  using Kernel = bool (*)(std::string_view);
+
+  static constexpr size_t kMaxKeyBytes = 48;
+  // A key is looked for in this many consecutive slots from its hash.
+  static constexpr size_t kProbes = 4;
+
+  // At least `slots` slots, rounded up to a power of two.
+  ResultCache(Kernel kernel, size_t slots);
+
+  // kernel(key), from the cache if it is there, and cached if not.
+  bool Get(std::string_view key) {
+    if (key.size() > kMaxKeyBytes) {
+      return kernel_(key);
+    }
+    const Key packed = Pack(key);
+    if (const std::optional<bool> cached = Lookup(packed)) {
+      return *cached;
+    }
+    const bool result = kernel_(key);
+    Insert(packed, result);
+    return result;
+  }
+
+  // The halves of Get, for measuring a hit and a miss separately. Lookup is
+  // nullopt, and Insert does nothing, for keys longer than kMaxKeyBytes.
+  std::optional<bool> Lookup(std::string_view key) const {
+    if (key.size() > kMaxKeyBytes) {
+      return std::nullopt;
+    }
+    return Lookup(Pack(key));
+  }
+  void Insert(std::string_view key, bool result) {
+    if (key.size() <= kMaxKeyBytes) {
+      Insert(Pack(key), result);
+    }
+  }
+
+  size_t slots() const { return mask_ + 1; }
+
+ private:
+  static constexpr size_t kKeyWords = kMaxKeyBytes / sizeof(uint64_t);
+
+  // A key zero-padded to whole words, with its hash.
+  struct Key {
+    uint64_t words[kKeyWords];
+    // The length, whether the result is true, and the top bits of the hash,
+    // as stored in Slot::meta. Never 0, which marks an empty slot.
+    uint64_t meta;
+    uint64_t hash;
+  };
+
+  // Every field is atomic so that a read racing a write is defined; the loads
+  // and stores are relaxed, and ordered by the fences around `sequence`,
+  // which is odd while the slot is being written.
+  struct alignas(64) Slot {
+    std::atomic<uint64_t> sequence{0};
+    std::atomic<uint64_t> meta{0};
+    std::atomic<uint64_t> words[kKeyWords] = {};
+  };
+  static_assert(sizeof(Slot) == 64);
+
+  static constexpr uint64_t kResultBit = uint64_t{1} << 8;
+
+  static Key Pack(std::string_view key);
+  std::optional<bool> Lookup(const Key& key) const;
+  void Insert(const Key& key, bool result);
+
+  Kernel kernel_;
+  size_t mask_;
+  std::unique_ptr<Slot[]> slots_;
+};
+
+}  // namespace charscan
+
+#endif  // RESULT_CACHE_H_
@@ -0,0 +1,152 @@
+// Sets of codepoints, matched in UTF-8 text. The set is a CharSet spelled in
+// UTF-8, e.g. CharSet("aeéè"), and each of its codepoints is a needle of an
+// Aho-Corasick DFA built as in MakeRegexTable, so a multibyte codepoint is
+// matched as the byte sequence that encodes it. UTF-8 is self-synchronizing:
+// in valid UTF-8 that sequence can only occur where the codepoint does, so
+// the DFA needs no notion of codepoint boundaries. Invalid sequences never
+// match.
+
+#ifndef UTF8_H_
+#define UTF8_H_
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "charscan.h"
+#include "charset.h"
+#include "multisearch.h"
+
+namespace charscan {
+
+// The length of the UTF-8 sequence that lead byte c starts. Continuation
+// bytes, which start nothing, count as one byte.
+constexpr size_t Utf8SequenceLength(char c) {
+  const auto b = static_cast<uint8_t>(c);
+  if (b >= 0xf0) return 4;
+  if (b >= 0xe0) return 3;
+  if (b >= 0xc0) return 2;
+  return 1;
+}
+
+// The codepoints of set, each as the bytes that encode it.
+constexpr std::vector<std::string_view> Utf8Codepoints(std::string_view set) {
+  std::vector<std::string_view> codepoints;
+  for (size_t i = 0; i < set.size();) {
+    const size_t length = std::min(Utf8SequenceLength(set[i]), set.size() - i);
+    codepoints.push_back(set.substr(i, length));
+    i += length;
+  }
+  return codepoints;
+}
+
+template <CharSet Set>
+constexpr std::vector<uint32_t> MakeUtf8Dfa() {
+  const std::vector<std::string_view> codepoints = Utf8Codepoints(Set.view());
+  return MakeAhoCorasickDfa(codepoints, IdentityByteClasses());
+}
+
+// One state per proper prefix of a multibyte codepoint, i.e. per distinct
+// lead byte (and lead pair, and so on), plus the start and match states.
+template <CharSet Set>
+constexpr std::array<std::array<uint8_t, kSize>, MakeUtf8Dfa<Set>().size() /
+                                                     kSize>
+MakeUtf8Table() {
+  const std::vector<uint32_t> dfa = MakeUtf8Dfa<Set>();
+  std::array<std::array<uint8_t, kSize>, MakeUtf8Dfa<Set>().size() / kSize>
+      table = {};
+  for (size_t state = 0; state < table.size(); ++state) {
+    for (int idx = 0; idx < kSize; ++idx) {
+      table[state][idx] = dfa[state * kSize + idx];
+    }
+  }
+  return table;
+}
+
+template <CharSet Set>
+inline constexpr auto kUtf8TableOf = MakeUtf8Table<Set>();
+
+// The table has a column per byte, but every byte that is in no codepoint of
+// the set behaves the same, so compressed it fits in a few cache lines.
+template <CharSet Set>
+inline constexpr auto kUtf8ClassesOf = MakeDfaByteClasses(kUtf8TableOf<Set>);
+
+template <CharSet Set>
+inline constexpr auto kUtf8DfaOf =
+    MakeClassDfa<kUtf8ClassesOf<Set>.num_classes>(kUtf8TableOf<Set>,
+                                                  kUtf8ClassesOf<Set>);
+
+// The nibble tables of the ASCII codepoints of Set.
+template <CharSet Set>
+constexpr NibbleTables MakeAsciiNibbleTables() {
+  std::array<char, Set.view().size()> ascii = {};
+  size_t size = 0;
+  for (char c : Set.view()) {
+    if (static_cast<uint8_t>(c) < 0x80) {
+      ascii[size++] = c;
+    }
+  }
+  return MakeNibbleTables({ascii.data(), size});
+}
+
+template <CharSet Set>
+inline constexpr auto kAsciiNibbleTablesOf = MakeAsciiNibbleTables<Set>();
+
+// The DFA over every byte, with an early return like
+// HasAnyOfRegexClassesEarlyReturn.
+template <CharSet Set>
+bool HasAnyOfUtf8Dfa(std::string_view haystack) {
+  constexpr auto& dfa = kUtf8DfaOf<Set>;
+  uint8_t state = dfa.Premultiply(kAhoCorasickStart);
+  for (auto c : haystack) {
+    state = dfa.transitions[state + dfa.byte_class[ByteIndex(c)]];
+    if (state == dfa.Premultiply(kAhoCorasickMatch)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// How far the DFA runs before HasAnyOfUtf8 looks for ASCII again. Long
+// enough that text with little ASCII, like Cyrillic with its spaces, does not
+// switch at every byte; short enough that the DFA skips little ASCII.
+inline constexpr size_t kUtf8DfaRun = 16;
+
+// The DFA only where the text is not ASCII. An ASCII run (see AsciiPrefix)
+// is tested with HasAnyOfNibble on the ASCII codepoints of the set: an ASCII
+// byte is never part of a multibyte codepoint, so it can only match as
+// itself, and it sends the DFA back to the start state. The rest goes through
+// the DFA kUtf8DfaRun bytes at a time, and the state carries over when a
+// codepoint is split between two of those.
+template <CharSet Set>
+bool HasAnyOfUtf8(std::string_view haystack) {
+  constexpr auto& dfa = kUtf8DfaOf<Set>;
+  uint8_t state = dfa.Premultiply(kAhoCorasickStart);
+  size_t pos = 0;
+  while (pos < haystack.size()) {
+    const size_t ascii = AsciiPrefix(haystack.substr(pos));
+    if (ascii > 0) {
+      if (HasAnyOfNibble(haystack.substr(pos, ascii),
+                         kAsciiNibbleTablesOf<Set>)) {
+        return true;
+      }
+      state = dfa.Premultiply(kAhoCorasickStart);
+      pos += ascii;
+    }
+    const size_t end = std::min(haystack.size(), pos + kUtf8DfaRun);
+    for (; pos < end; ++pos) {
+      state = dfa.transitions[state + dfa.byte_class[ByteIndex(haystack[pos])]];
+      if (state == dfa.Premultiply(kAhoCorasickMatch)) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+}  // namespace charscan
+
+#endif  // UTF8_H_
@@ -1,213 +1,1840 @@
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
 #include <algorithm>
 #include <array>
-#include <limits>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <optional>
 #include <random>
+#include <regex>
+#include <span>
 #include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#include <utility>
+#include <vector>
 
+#include "absl/flags/flag.h"
+#include "absl/flags/parse.h"
+#include "absl/strings/charset.h"
+#include "absl/strings/match.h"
+#include "adaptive.h"
 #include "benchmark/benchmark.h"
+#include "calibration.h"
+#include "charscan.h"
+#include "charset.h"
+#include "corpus.h"
+#include "latency.h"
+#include "multisearch.h"
+#include "pipeline.h"
+#include "re2/re2.h"
+#include "result_cache.h"
+#include "vowels.h"
 
-static constexpr std::string_view kVowels = "aeiouAEIOU";
+using charscan::BitVectorWords;
+using charscan::CharSet;
+using charscan::CountVowelsLoop;
+using charscan::CountVowelsSimd;
+using charscan::CpuHasAvx2;
+using charscan::CpuHasAvx512Bw;
+using charscan::CpuHasSsse3;
+using charscan::FindAllVowelsLoop;
+using charscan::FindAllVowelsSimd;
+using charscan::FindFirstVowelLoop;
+using charscan::FindFirstVowelSimd;
+using charscan::FixedLengthDistribution;
+using charscan::HasAnyOfLoop;
+using charscan::HasAnyOfLoopInterchanged;
+using charscan::HasAnyOfNibble;
+using charscan::HasAnyOfSwar;
+using charscan::HasVowelBatch;
+using charscan::HasVowelLoop;
+using charscan::HasVowelLoopInterchanged;
+using charscan::HasVowelRegex;
+using charscan::HasVowelRegexClasses;
+using charscan::HasVowelRegexClassesEarlyReturn;
+using charscan::HasVowelRegexEarlyReturn;
+using charscan::HasVowelRegexInt;
+using charscan::HasVowelRegexInterleaved1;
+using charscan::HasVowelRegexInterleaved2;
+using charscan::HasVowelRegexInterleaved4;
+using charscan::HasVowelRegexInterleaved8;
+using charscan::HasVowelSimd;
+using charscan::HasVowelSwar;
+using charscan::HasVowelSwarAligned;
+using charscan::HasVowelUtf8;
+using charscan::HasVowelUtf8Dfa;
+using charscan::LongStringDistribution;
+using charscan::MakeHeapStrings;
+using charscan::MakeNibbleTables;
+using charscan::MakeStrings;
+using charscan::MakeUtf8Strings;
+using charscan::MakeZipfStrings;
+using charscan::MatchStrategy;
+using charscan::MixSeed;
+using charscan::NibbleTables;
+using charscan::ResultCache;
+using charscan::ShortStringDistribution;
+using charscan::StringCorpus;
+using charscan::VowelChunkedString;
+using charscan::VowelScanner;
+using charscan::VowelSegmentTree;
+using charscan::kCharsWithVowels;
+using charscan::kNibbleTablesOf;
+using charscan::kNoFirstVowel;
+using charscan::kUniformVowelProbability;
+using charscan::kVowelNibbleTables;
+using charscan::kVowelSet;
+using charscan::kVowels;
+#if defined(__x86_64__) || defined(__i386__)
+using charscan::HasAnyOfNibbleSsse3;
+using charscan::HasAnyOfNibbleAvx2;
+using charscan::HasAnyOfNibbleShortAvx2;
+using charscan::HasAnyOfNibbleShortAvx512;
+using charscan::HasAnyOfNibbleShortSsse3;
+using charscan::HasVowelAvx2;
+using charscan::HasVowelSse2;
+#elif defined(__aarch64__)
+using charscan::HasAnyOfNibbleNeon;
+using charscan::HasAnyOfNibbleShortNeon;
+using charscan::HasVowelNeon;
+#endif
 
-static bool HasVowelLoop(std::string_view haystack) {
+// What we would write without a hand-written kernel, as baselines for the
+// kernels in vowels.h.
+static bool HasVowelFindFirstOf(std::string_view haystack) {
+  return haystack.find_first_of(kVowels) != std::string_view::npos;
+}
+
+static bool HasVowelMemchr(std::string_view haystack) {
   for (char v : kVowels) {
-    for (int i = 0; i < haystack.size(); ++i) {
-      if (haystack[i] == v) {
-        return true;
-      }
+    if (std::memchr(haystack.data(), v, haystack.size()) != nullptr) {
+      return true;
     }
   }
   return false;
 }
 
-static bool HasVowelLoopInterchanged(std::string_view haystack) {
-  for (int i = 0; i < haystack.size(); ++i) {
-    for (char v : kVowels) {
-      if (haystack[i] == v) {
-        return true;
-      }
+static bool HasVowelStrContains(std::string_view haystack) {
+  for (char v : kVowels) {
+    if (absl::StrContains(haystack, v)) {
+      return true;
     }
   }
   return false;
 }
 
-// Initialize regex table. I did not verify that the table is actually correct;
-// but the performance of the code should not depend on the table entries (as
-// long as the entries are not trivial).
-static constexpr char kCharMin = std::numeric_limits<char>::min();
-static constexpr char kCharMax = std::numeric_limits<char>::max();
-static constexpr int kSize = kCharMax - kCharMin + 1;
-
-static constexpr int kReject = 0;
-static constexpr int kAccept = 1;
-static constexpr std::array<std::array<int, kSize>, 2> MakeRegexTable() {
-  std::array<std::array<int, kSize>, 2> tbl = {};
-
-  // Important to use int here so we don't overflow char
-  for (int c = kCharMin; c <= kCharMax; ++c) {
-    // char might be signed, so need to make sure idx starts at 0.
-    int idx = c - kCharMin;
-    if (kVowels.find(static_cast<char>(c)) != -1) {
-      tbl[kReject][idx] = kAccept;
-    } else {
-      tbl[kReject][idx] = kReject;
+static bool HasVowelAbslCharSet(std::string_view haystack) {
+  static constexpr absl::CharSet kVowelCharSet(kVowels);
+  for (char c : haystack) {
+    if (kVowelCharSet.contains(c)) {
+      return true;
     }
-    tbl[kAccept][idx] = kAccept;
   }
+  return false;
+}
 
-  return tbl;
+static bool HasVowelStdRegex(std::string_view haystack) {
+  static const auto* re = new std::regex("[aeiouAEIOU]");
+  return std::regex_search(haystack.begin(), haystack.end(), *re);
 }
 
-static constexpr auto kRegexTable = MakeRegexTable();
+static bool HasVowelRe2(std::string_view haystack) {
+  static const auto* re = new RE2("[aeiouAEIOU]");
+  return RE2::PartialMatch(haystack, *re);
+}
 
-static bool HasVowelRegex(std::string_view haystack) {
-  int state = kReject;
-  for (auto c : haystack) {
-    state = kRegexTable[state][c];
-  }
+static constexpr int kShortNumStrings = 1'000;
+static constexpr int kLongNumStrings = 1'000;
 
-  return state == kAccept;
-}
+// A read-only mapping of a whole file. The mapping is private to the process
+// but shares the page cache, so how the pages are faulted in is what the
+// options control:
+//   populate:   MAP_POPULATE, fault every page in during mmap.
+//   sequential: madvise(MADV_SEQUENTIAL), read ahead aggressively and drop
+//               pages behind the reader.
+class MappedFile {
+ public:
+  struct Options {
+    bool populate = false;
+    bool sequential = false;
+  };
 
-static bool HasVowelRegexEarlyReturn(std::string_view haystack) {
-  int state = kReject;
-  for (auto c : haystack) {
-    state = kRegexTable[state][c];
-    if (state == kAccept) {
-      return true;
+  // Returns nullptr if the file cannot be opened or mapped.
+  static std::unique_ptr<MappedFile> Open(const std::string& path,
+                                          Options options) {
+    const int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) return nullptr;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      return nullptr;
     }
+    const size_t size = st.st_size;
+    void* data = nullptr;
+    // mmap rejects empty mappings; an empty file is just an empty corpus.
+    if (size > 0) {
+      int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+      if (options.populate) flags |= MAP_POPULATE;
+#endif
+      data = mmap(nullptr, size, PROT_READ, flags, fd, 0);
+      if (data == MAP_FAILED) {
+        close(fd);
+        return nullptr;
+      }
+      if (options.sequential) madvise(data, size, MADV_SEQUENTIAL);
+    }
+    return std::unique_ptr<MappedFile>(
+        new MappedFile(fd, static_cast<const char*>(data), size));
   }
 
-  return false;
-}
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
 
-static constexpr std::string_view kCharsWithVowels =
-    "0123456789"
-    "abcdefghijklmnopqrstuvwxyz"
-    "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
+  ~MappedFile() {
+    if (size_ > 0) munmap(const_cast<char*>(data_), size_);
+    close(fd_);
+  }
 
-static constexpr std::string_view kCharsNoVowels =
-    "0123456789"
-    "bcdfghjklmnpqrstvwxyz"
-    "BCDFGHJKLMNPQRSTVWXYZ";
+  std::string_view contents() const { return {data_, size_}; }
 
-static constexpr int kShortNumStrings = 1'000;
-static constexpr int kLongNumStrings = 1'000;
+ private:
+  MappedFile(int fd, const char* data, size_t size)
+      : fd_(fd), data_(data), size_(size) {}
 
-static constexpr auto ShortStringDistribution(std::mt19937& rng) {
-  return [&]() {
-    std::binomial_distribution<> d(15, 0.5);
-    return d(rng) + 5;
-  };
-}
+  int fd_;
+  const char* data_;
+  size_t size_;
+};
 
-static constexpr auto LongStringDistribution(std::mt19937& rng) {
-  return [&]() {
-    std::binomial_distribution<> d(10000, 0.5);
-    return d(rng);
-  };
+ABSL_FLAG(uint64_t, corpus_seed, 42,
+          "Seed for the generated benchmark corpora. Runs with the same seed "
+          "measure the same data.");
+ABSL_FLAG(std::string, corpus_file, "",
+          "Text file for the BM_*_File benchmarks, which split it into one "
+          "string per line. Dictionaries, logs and CSVs all work.");
+
+// FNV-1a; unlike std::hash its value is fixed, so fixture seeds are too.
+static constexpr uint64_t HashName(std::string_view name) {
+  uint64_t hash = 0xcbf29ce484222325;
+  for (char c : name) {
+    hash = (hash ^ static_cast<uint8_t>(c)) * 0x100000001b3;
+  }
+  return hash;
 }
 
+// Benchmark inputs. Fixtures are registered by name during static
+// initialization, like the benchmarks themselves, but are only built the
+// first time a benchmark asks for one; after that every benchmark gets a
+// reference to the same instance. Each fixture's seed is derived from
+// --corpus_seed and its name.
 template <typename T>
-static std::unique_ptr<std::vector<std::string>> MakeStrings(
-    std::mt19937& rng, std::string_view characters, int num_strings,
-    T string_length) {
-  auto strs = std::make_unique<std::vector<std::string>>();
-  strs->reserve(num_strings);
-
-  std::uniform_int_distribution<> char_dist(0, characters.size() - 1);
-  auto generate_one = [&]() -> std::string {
-    std::string result;
-    std::generate_n(std::back_inserter(result), string_length(),
-                    [&]() { return characters[char_dist(rng)]; });
-    return result;
-  };
+class FixtureRegistry {
+ public:
+  using Builder = std::function<T(uint64_t seed)>;
 
-  std::generate_n(std::back_inserter(*strs), num_strings, generate_one);
+  static FixtureRegistry& Global() {
+    static auto* registry = new FixtureRegistry;
+    return *registry;
+  }
 
-  return strs;
-}
+  bool Register(std::string_view name, Builder build) {
+    entries_.emplace(name, std::make_unique<Entry>(std::move(build)));
+    return true;
+  }
 
-static std::vector<std::string>& ShortWithVowels() {
-  static std::vector<std::string>* strs = nullptr;
-  if (strs == nullptr) {
-    std::random_device dev;
-    std::mt19937 rng(dev());
-    strs = MakeStrings(rng, kCharsWithVowels, /*num_strings=*/kShortNumStrings,
-                       ShortStringDistribution(rng))
-               .release();
+  const T& Get(std::string_view name) {
+    Entry& entry = *entries_.find(name)->second;
+    std::call_once(entry.once, [&] {
+      uint64_t seed = MixSeed(absl::GetFlag(FLAGS_corpus_seed), HashName(name));
+      entry.value = std::make_unique<T>(entry.build(seed));
+    });
+    return *entry.value;
   }
 
-  return *strs;
-}
+ private:
+  struct Entry {
+    explicit Entry(Builder build) : build(std::move(build)) {}
+
+    Builder build;
+    std::once_flag once;
+    std::unique_ptr<T> value;
+  };
 
-static std::vector<std::string>& ShortNoVowels() {
-  static std::vector<std::string>* strs = nullptr;
-  if (strs == nullptr) {
-    std::random_device dev;
-    std::mt19937 rng(dev());
-    strs = MakeStrings(rng, kCharsNoVowels, /*num_strings=*/kShortNumStrings,
-                       ShortStringDistribution(rng))
-               .release();
+  // Only written during static initialization.
+  std::map<std::string, std::unique_ptr<Entry>, std::less<>> entries_;
+};
+
+// Defines `const Type& Name()`, which returns the shared fixture.
+#define REGISTER_FIXTURE(Type, Name, Build...)                \
+  [[maybe_unused]] static const bool Name##Registered =       \
+      FixtureRegistry<Type>::Global().Register(#Name, Build); \
+  static const Type& Name() {                                 \
+    return FixtureRegistry<Type>::Global().Get(#Name);        \
   }
 
-  return *strs;
+// The default fixtures use the contiguous StringCorpus layout. The *Heap
+// fixtures hold the same strings as a std::vector<std::string>, so that the
+// effect of the data layout can be measured on its own.
+#define REGISTER_CORPUS(Name, NumStrings, Distribution, VowelProbability) \
+  REGISTER_FIXTURE(StringCorpus, Name, [](uint64_t seed) {                \
+    return MakeStrings(seed, NumStrings, Distribution, VowelProbability); \
+  })                                                                      \
+  REGISTER_FIXTURE(std::vector<std::string>, Name##Heap,                  \
+                   [](uint64_t) { return MakeHeapStrings(Name()); })
+
+REGISTER_CORPUS(ShortWithVowels, kShortNumStrings, ShortStringDistribution,
+                kUniformVowelProbability)
+REGISTER_CORPUS(ShortNoVowels, kShortNumStrings, ShortStringDistribution,
+                /*VowelProbability=*/0)
+REGISTER_CORPUS(LongWithVowels, kLongNumStrings, LongStringDistribution,
+                kUniformVowelProbability)
+REGISTER_CORPUS(LongNoVowels, kLongNumStrings, LongStringDistribution,
+                /*VowelProbability=*/0)
+
+// Sweep corpora are parameterized by the benchmark arguments: num_strings
+// strings of exactly `length` bytes, with about kSweepBytes in total. Only the
+// most recently used one is kept. A benchmark family runs its arguments in
+// order, so consecutive runs share it, and the largest are 64 MiB each.
+static constexpr size_t kSweepBytes = 16 << 20;
+static constexpr size_t kMaxSweepStrings = 1'000;
+
+static const StringCorpus& SweepCorpus(size_t length, int vowel_permille,
+                                       size_t first_vowel) {
+  using Key = std::tuple<size_t, int, size_t>;
+  static Key key;
+  static std::unique_ptr<StringCorpus> corpus;
+  if (corpus == nullptr || key != Key(length, vowel_permille, first_vowel)) {
+    key = Key(length, vowel_permille, first_vowel);
+    corpus = nullptr;
+    const uint64_t seed = MixSeed(
+        absl::GetFlag(FLAGS_corpus_seed),
+        HashName("Sweep") ^ MixSeed(length, vowel_permille ^ first_vowel));
+    const int num_strings = std::clamp<size_t>(kSweepBytes / length, 1,
+                                               kMaxSweepStrings);
+    corpus = std::make_unique<StringCorpus>(
+        MakeStrings(seed, num_strings, FixedLengthDistribution(length),
+                    vowel_permille / 1000.0, first_vowel));
+  }
+  return *corpus;
 }
-static std::vector<std::string>& LongWithVowels() {
-  static std::vector<std::string>* strs = nullptr;
-  if (strs == nullptr) {
-    std::random_device dev;
-    std::mt19937 rng(dev());
-    strs = MakeStrings(rng, kCharsWithVowels, /*num_strings=*/kLongNumStrings,
-                       LongStringDistribution(rng))
-               .release();
+
+// The lines of --corpus_file, as (offset, size) pairs rather than views, so
+// that they can be applied to a fresh mapping of the file. Built from a
+// mapping that is released again, which leaves the file in the page cache.
+struct Line {
+  size_t offset;
+  size_t size;
+};
+
+static std::vector<Line> SplitLines(std::string_view contents) {
+  std::vector<Line> lines;
+  for (size_t begin = 0; begin < contents.size();) {
+    size_t end = contents.find('\n', begin);
+    if (end == std::string_view::npos) end = contents.size();
+    lines.push_back({begin, end - begin});
+    begin = end + 1;
   }
+  return lines;
+}
+
+REGISTER_FIXTURE(std::vector<Line>, FileLines, [](uint64_t) {
+  const auto file = MappedFile::Open(absl::GetFlag(FLAGS_corpus_file), {});
+  return file == nullptr ? std::vector<Line>() : SplitLines(file->contents());
+})
 
-  return *strs;
+// Hardware counters (--benchmark_perf_counters) are reported per iteration.
+// Recording the haystack size alongside them lets PerfCounterReporter below
+// derive per-byte costs.
+template <typename Strings>
+static int64_t TotalBytes(const Strings& strs) {
+  int64_t bytes = 0;
+  for (std::string_view s : strs) bytes += s.size();
+  return bytes;
 }
 
-static std::vector<std::string>& LongNoVowels() {
-  static std::vector<std::string>* strs = nullptr;
-  if (strs == nullptr) {
-    std::random_device dev;
-    std::mt19937 rng(dev());
-    strs = MakeStrings(rng, kCharsNoVowels, /*num_strings=*/kLongNumStrings,
-                       LongStringDistribution(rng))
-               .release();
-  }
+static void SetHaystackBytes(benchmark::State& state, int64_t bytes) {
+  state.counters["bytes"] = benchmark::Counter(
+      static_cast<double>(state.iterations() * bytes),
+      benchmark::Counter::kAvgIterations);
+}
 
-  return *strs;
+// Likewise the number of strings, and what the harness loop costs per string
+// on them (see calibration.h), for PerfCounterReporter to report ns per string
+// with and without the harness. The baseline is measured once per fixture.
+template <typename Strings>
+static void SetHarnessBaseline(benchmark::State& state, const Strings& strs) {
+  static auto* baselines = new std::map<const Strings*, double>;
+  auto [baseline, inserted] = baselines->try_emplace(&strs);
+  if (inserted) baseline->second = charscan::HarnessNsPerString(strs);
+  state.counters["strings"] = benchmark::Counter(
+      static_cast<double>(state.iterations() * std::size(strs)),
+      benchmark::Counter::kAvgIterations);
+  state.counters["harness_ns"] = baseline->second;
+}
+
+ABSL_FLAG(bool, latency, false,
+          "Time every call of the BM_HasVowel* kernels and report the p50, "
+          "p99 and p999 call latency in ns. The timer costs about as much as "
+          "a call on short strings, so Time is not comparable with a normal "
+          "run's.");
+
+// Each call is timed on its own, less the timer's own overhead, and the
+// timings are collected in a histogram that lasts the whole run. That shows
+// the calls that take much longer than the mean: page crossings, branch
+// mispredicts, the odd string the kernel handles slowly. `call` is passed
+// each string.
+template <typename Strings, typename Call>
+static void MeasureLatency(benchmark::State& state, const Strings& strs,
+                           Call call) {
+  const uint64_t overhead = charscan::TimerOverheadTicks();
+  charscan::LatencyHistogram histogram;
+  for (auto _ : state) {
+    for (std::string_view s : strs) {
+      const uint64_t start = charscan::ReadTicks();
+      benchmark::DoNotOptimize(call(s));
+      const uint64_t ticks = charscan::ReadTicks() - start;
+      histogram.Record(ticks > overhead ? ticks - overhead : 0);
+    }
+  }
+  const double ns_per_tick = 1 / charscan::TicksPerNanosecond();
+  state.counters["p50_ns"] = histogram.Percentile(0.5) * ns_per_tick;
+  state.counters["p99_ns"] = histogram.Percentile(0.99) * ns_per_tick;
+  state.counters["p999_ns"] = histogram.Percentile(0.999) * ns_per_tick;
+  state.counters["timer_ns"] = overhead * ns_per_tick;
 }
 
-#define BENCHMARK_HAS_VOWEL(Fn, Data, Args...)                              \
+// Kernels that need an ISA extension are registered with
+// BENCHMARK_HAS_VOWEL_IF so that they are skipped, rather than crash with
+// SIGILL, on CPUs without it.
+#define BENCHMARK_HAS_VOWEL_IF(Supported, Fn, Data, Args...)                \
   static void BM_##Fn##_##Data(benchmark::State& state) {                   \
-    auto strs = Data();                                                     \
-    for (auto _ : state) {                                                  \
-      for (const std::string& s : strs) benchmark::DoNotOptimize(Fn(Args)); \
+    if (!(Supported)) {                                                     \
+      state.SkipWithError("unsupported CPU");                               \
+      return;                                                               \
+    }                                                                       \
+    const auto& strs = Data();                                              \
+    if (absl::GetFlag(FLAGS_latency)) {                                     \
+      MeasureLatency(state, strs,                                           \
+                     [&](std::string_view s) { return Fn(Args); });         \
+    } else {                                                                \
+      for (auto _ : state) {                                                \
+        for (std::string_view s : strs) benchmark::DoNotOptimize(Fn(Args)); \
+      }                                                                     \
+      SetHarnessBaseline(state, strs);                                      \
     }                                                                       \
+    SetHaystackBytes(state, TotalBytes(strs));                              \
   }                                                                         \
                                                                             \
   BENCHMARK(BM_##Fn##_##Data);
 
+#define BENCHMARK_HAS_VOWEL(Fn, Data, Args...) \
+  BENCHMARK_HAS_VOWEL_IF(true, Fn, Data, Args)
+
+// Batch kernels answer the whole dataset in one call.
+#define BENCHMARK_HAS_VOWEL_BATCH(Fn, Data)                              \
+  static void BM_##Fn##_##Data(benchmark::State& state) {                \
+    const auto& strs = Data();                                           \
+    const std::vector<std::string_view> views(strs.begin(), strs.end()); \
+    std::vector<uint64_t> bits(BitVectorWords(views.size()));            \
+    for (auto _ : state) {                                               \
+      Fn(views, bits);                                                   \
+      benchmark::DoNotOptimize(bits.data());                             \
+      benchmark::ClobberMemory();                                        \
+    }                                                                    \
+    SetHaystackBytes(state, TotalBytes(strs));                           \
+  }                                                                      \
+                                                                         \
+  BENCHMARK(BM_##Fn##_##Data);
+
+// The positions buffer is sized for the longest string and allocated once,
+// so that the loop measures only the kernel.
+#define BENCHMARK_FIND_ALL_VOWELS(Fn, Data)               \
+  static void BM_##Fn##_##Data(benchmark::State& state) { \
+    const auto& strs = Data();                            \
+    size_t max_size = 0;                                  \
+    for (std::string_view s : strs) {                     \
+      max_size = std::max(max_size, s.size());            \
+    }                                                     \
+    std::vector<size_t> positions(max_size);              \
+    for (auto _ : state) {                                \
+      for (std::string_view s : strs) {                   \
+        benchmark::DoNotOptimize(Fn(s, positions));       \
+        benchmark::ClobberMemory();                       \
+      }                                                   \
+    }                                                     \
+    SetHaystackBytes(state, TotalBytes(strs));            \
+  }                                                       \
+                                                          \
+  BENCHMARK(BM_##Fn##_##Data);
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCHMARK_HAS_VOWEL_ARCH(Data, Args...)                          \
+  BENCHMARK_HAS_VOWEL(HasVowelSse2, Data, Args)                          \
+  BENCHMARK_HAS_VOWEL_IF(CpuHasAvx2(), HasVowelAvx2, Data, Args)         \
+  BENCHMARK_HAS_VOWEL_IF(CpuHasSsse3(), HasAnyOfNibbleSsse3, Data, Args, \
+                         kVowelNibbleTables)                             \
+  BENCHMARK_HAS_VOWEL_IF(CpuHasAvx2(), HasAnyOfNibbleAvx2, Data, Args,   \
+                         kVowelNibbleTables)
+#elif defined(__aarch64__)
+#define BENCHMARK_HAS_VOWEL_ARCH(Data, Args...) \
+  BENCHMARK_HAS_VOWEL(HasVowelNeon, Data, Args) \
+  BENCHMARK_HAS_VOWEL(HasAnyOfNibbleNeon, Data, Args, kVowelNibbleTables)
+#else
+#define BENCHMARK_HAS_VOWEL_ARCH(Data, Args...)
+#endif
+
+// The loop-free kernels for strings of at most kShortHaystack bytes, to
+// compare against the generic ones above.
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCHMARK_HAS_VOWEL_SHORT(Data)                                     \
+  BENCHMARK_HAS_VOWEL_IF(CpuHasSsse3(), HasAnyOfNibbleShortSsse3, Data, s,  \
+                         kVowelNibbleTables)                                \
+  BENCHMARK_HAS_VOWEL_IF(CpuHasAvx2(), HasAnyOfNibbleShortAvx2, Data, s,    \
+                         kVowelNibbleTables)                                \
+  BENCHMARK_HAS_VOWEL_IF(CpuHasAvx512Bw(), HasAnyOfNibbleShortAvx512, Data, \
+                         s, kVowelNibbleTables)
+#elif defined(__aarch64__)
+#define BENCHMARK_HAS_VOWEL_SHORT(Data) \
+  BENCHMARK_HAS_VOWEL(HasAnyOfNibbleShortNeon, Data, s, kVowelNibbleTables)
+#else
+#define BENCHMARK_HAS_VOWEL_SHORT(Data)
+#endif
+
 BENCHMARK_HAS_VOWEL(HasVowelLoop, ShortWithVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelLoopInterchanged, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwar, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwarAligned, ShortWithVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelRegex, ShortWithVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelRegexEarlyReturn, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInt, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexClasses, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexClassesEarlyReturn, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved1, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved2, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved4, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved8, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL_ARCH(ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, ShortWithVowels, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_SHORT(ShortWithVowels)
+BENCHMARK_HAS_VOWEL_BATCH(HasVowelBatch, ShortWithVowels)
 
 BENCHMARK_HAS_VOWEL(HasVowelLoop, ShortNoVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelLoopInterchanged, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwar, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwarAligned, ShortNoVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelRegex, ShortNoVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelRegexEarlyReturn, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInt, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexClasses, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexClassesEarlyReturn, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved1, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved2, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved4, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved8, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL_ARCH(ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, ShortNoVowels, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_SHORT(ShortNoVowels)
+BENCHMARK_HAS_VOWEL_BATCH(HasVowelBatch, ShortNoVowels)
 
 BENCHMARK_HAS_VOWEL(HasVowelLoop, LongWithVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelLoopInterchanged, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwar, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwarAligned, LongWithVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelRegex, LongWithVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelRegexEarlyReturn, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInt, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexClasses, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexClassesEarlyReturn, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved1, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved2, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved4, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved8, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL_ARCH(LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, LongWithVowels, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_BATCH(HasVowelBatch, LongWithVowels)
 
 BENCHMARK_HAS_VOWEL(HasVowelLoop, LongNoVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelLoopInterchanged, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwar, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwarAligned, LongNoVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelRegex, LongNoVowels, s)
 BENCHMARK_HAS_VOWEL(HasVowelRegexEarlyReturn, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInt, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexClasses, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexClassesEarlyReturn, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved1, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved2, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved4, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexInterleaved8, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL_ARCH(LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, LongNoVowels, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_BATCH(HasVowelBatch, LongNoVowels)
+
+// Counting and finding positions. Unlike HasVowel*, CountVowels* and
+// FindAllVowels* read every byte even when the strings have vowels.
+BENCHMARK_HAS_VOWEL(CountVowelsLoop, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(CountVowelsSimd, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(FindFirstVowelLoop, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(FindFirstVowelSimd, ShortWithVowels, s)
+BENCHMARK_FIND_ALL_VOWELS(FindAllVowelsLoop, ShortWithVowels)
+BENCHMARK_FIND_ALL_VOWELS(FindAllVowelsSimd, ShortWithVowels)
+
+BENCHMARK_HAS_VOWEL(CountVowelsLoop, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(CountVowelsSimd, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(FindFirstVowelLoop, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(FindFirstVowelSimd, ShortNoVowels, s)
+BENCHMARK_FIND_ALL_VOWELS(FindAllVowelsLoop, ShortNoVowels)
+BENCHMARK_FIND_ALL_VOWELS(FindAllVowelsSimd, ShortNoVowels)
+
+BENCHMARK_HAS_VOWEL(CountVowelsLoop, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(CountVowelsSimd, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(FindFirstVowelLoop, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(FindFirstVowelSimd, LongWithVowels, s)
+BENCHMARK_FIND_ALL_VOWELS(FindAllVowelsLoop, LongWithVowels)
+BENCHMARK_FIND_ALL_VOWELS(FindAllVowelsSimd, LongWithVowels)
+
+BENCHMARK_HAS_VOWEL(CountVowelsLoop, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(CountVowelsSimd, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(FindFirstVowelLoop, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(FindFirstVowelSimd, LongNoVowels, s)
+BENCHMARK_FIND_ALL_VOWELS(FindAllVowelsLoop, LongNoVowels)
+BENCHMARK_FIND_ALL_VOWELS(FindAllVowelsSimd, LongNoVowels)
+
+// Library baselines. A hand-written kernel has to beat these to be worth
+// keeping.
+BENCHMARK_HAS_VOWEL(HasVowelFindFirstOf, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelMemchr, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelStrContains, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelAbslCharSet, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelStdRegex, ShortWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRe2, ShortWithVowels, s)
+
+BENCHMARK_HAS_VOWEL(HasVowelFindFirstOf, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelMemchr, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelStrContains, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelAbslCharSet, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelStdRegex, ShortNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRe2, ShortNoVowels, s)
+
+BENCHMARK_HAS_VOWEL(HasVowelFindFirstOf, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelMemchr, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelStrContains, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelAbslCharSet, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelStdRegex, LongWithVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRe2, LongWithVowels, s)
+
+BENCHMARK_HAS_VOWEL(HasVowelFindFirstOf, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelMemchr, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelStrContains, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelAbslCharSet, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelStdRegex, LongNoVowels, s)
+BENCHMARK_HAS_VOWEL(HasVowelRe2, LongNoVowels, s)
+
+// The same kernels over the old std::vector<std::string> layout.
+BENCHMARK_HAS_VOWEL(HasVowelLoopInterchanged, ShortWithVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwar, ShortWithVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwarAligned, ShortWithVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexEarlyReturn, ShortWithVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, ShortWithVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, ShortWithVowelsHeap, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_BATCH(HasVowelBatch, ShortWithVowelsHeap)
+
+BENCHMARK_HAS_VOWEL(HasVowelLoopInterchanged, ShortNoVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwar, ShortNoVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwarAligned, ShortNoVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexEarlyReturn, ShortNoVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, ShortNoVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, ShortNoVowelsHeap, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_BATCH(HasVowelBatch, ShortNoVowelsHeap)
+
+BENCHMARK_HAS_VOWEL(HasVowelLoopInterchanged, LongWithVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwar, LongWithVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwarAligned, LongWithVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexEarlyReturn, LongWithVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, LongWithVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, LongWithVowelsHeap, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_BATCH(HasVowelBatch, LongWithVowelsHeap)
+
+BENCHMARK_HAS_VOWEL(HasVowelLoopInterchanged, LongNoVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwar, LongNoVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwarAligned, LongNoVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelRegexEarlyReturn, LongNoVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, LongNoVowelsHeap, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, LongNoVowelsHeap, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_BATCH(HasVowelBatch, LongNoVowelsHeap)
+
+// Input sweeps, to find each kernel's crossover points. Every benchmark takes
+// (length, vowel_permille, first_vowel); first_vowel = -1 leaves the vowels
+// where the random draw put them. There are three families per kernel:
+//
+// - Length: strings of 1 B to 64 MiB with no vowels, so every byte is read.
+// - Density: the same lengths with a vowel probability of 0.1% to 50%.
+// - FirstVowel: 1 MiB strings whose first (and only) vowel is at a given
+//   position; first_vowel = length means there is none.
+//
+// N is the number of bytes an early-exit kernel has to read.
+static void LengthSweep(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"length", "vowel_permille", "first_vowel"})
+      ->ArgsProduct(
+          {benchmark::CreateRange(1, 64 << 20, /*multi=*/2), {0}, {-1}})
+      ->Complexity(benchmark::oN);
+}
+
+static void DensitySweep(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"length", "vowel_permille", "first_vowel"})
+      ->ArgsProduct({benchmark::CreateRange(16, 64 << 20, /*multi=*/16),
+                     {1, 10, 100, 500},
+                     {-1}});
+}
+
+static void FirstVowelSweep(benchmark::internal::Benchmark* b) {
+  std::vector<int64_t> positions = {0};
+  for (int64_t position : benchmark::CreateRange(1, 1 << 20, /*multi=*/4)) {
+    positions.push_back(position);
+  }
+  b->ArgNames({"length", "vowel_permille", "first_vowel"})
+      ->ArgsProduct({{1 << 20}, {0}, positions})
+      ->Complexity(benchmark::oN);
+}
+
+static const StringCorpus& SweepCorpus(const benchmark::State& state) {
+  const int64_t first_vowel = state.range(2);
+  return SweepCorpus(state.range(0), state.range(1),
+                     first_vowel < 0 ? kNoFirstVowel : first_vowel);
+}
+
+// Bytes per second are only reported when the number of bytes an early-exit
+// kernel reads is known, i.e. when no vowels were drawn at random.
+static void SetSweepCounters(benchmark::State& state,
+                             const StringCorpus& strs) {
+  const int64_t length = state.range(0);
+  const int64_t first_vowel = state.range(2);
+  const int64_t bytes_read = first_vowel < 0 || first_vowel >= length
+                                 ? length
+                                 : first_vowel + 1;
+  state.SetComplexityN(bytes_read);
+  state.SetItemsProcessed(state.iterations() * strs.size());
+  if (state.range(1) == 0) {
+    state.SetBytesProcessed(state.iterations() * strs.size() * bytes_read);
+  }
+  SetHaystackBytes(state, strs.bytes());
+}
+
+#define REGISTER_SWEEPS(Benchmark, Fn)                                   \
+  BENCHMARK(Benchmark)->Name("BM_" #Fn "_Length")->Apply(LengthSweep);   \
+  BENCHMARK(Benchmark)->Name("BM_" #Fn "_Density")->Apply(DensitySweep); \
+  BENCHMARK(Benchmark)                                                   \
+      ->Name("BM_" #Fn "_FirstVowel")                                    \
+      ->Apply(FirstVowelSweep);
+
+#define BENCHMARK_HAS_VOWEL_SWEEP(Fn, Args...)                            \
+  static void BM_##Fn##_Sweep(benchmark::State& state) {                  \
+    const StringCorpus& strs = SweepCorpus(state);                        \
+    for (auto _ : state) {                                                \
+      for (std::string_view s : strs) benchmark::DoNotOptimize(Fn(Args)); \
+    }                                                                     \
+    SetSweepCounters(state, strs);                                        \
+  }                                                                       \
+  REGISTER_SWEEPS(BM_##Fn##_Sweep, Fn)
+
+#define BENCHMARK_HAS_VOWEL_BATCH_SWEEP(Fn)                              \
+  static void BM_##Fn##_Sweep(benchmark::State& state) {                 \
+    const StringCorpus& strs = SweepCorpus(state);                       \
+    const std::vector<std::string_view> views(strs.begin(), strs.end()); \
+    std::vector<uint64_t> bits(BitVectorWords(views.size()));            \
+    for (auto _ : state) {                                               \
+      Fn(views, bits);                                                   \
+      benchmark::DoNotOptimize(bits.data());                             \
+      benchmark::ClobberMemory();                                        \
+    }                                                                    \
+    SetSweepCounters(state, strs);                                       \
+  }                                                                      \
+  REGISTER_SWEEPS(BM_##Fn##_Sweep, Fn)
+
+BENCHMARK_HAS_VOWEL_SWEEP(HasVowelLoopInterchanged, s)
+BENCHMARK_HAS_VOWEL_SWEEP(HasVowelSwar, s)
+BENCHMARK_HAS_VOWEL_SWEEP(HasVowelRegexEarlyReturn, s)
+BENCHMARK_HAS_VOWEL_SWEEP(HasVowelRegexInterleaved4, s)
+BENCHMARK_HAS_VOWEL_SWEEP(HasVowelSimd, s)
+BENCHMARK_HAS_VOWEL_SWEEP(HasAnyOfNibble, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_BATCH_SWEEP(HasVowelBatch)
+
+// Working-set sweeps: each kernel over corpora sized to fit in each level of
+// this host's cache hierarchy (half of each data cache, so that the rest of
+// the process fits too) and to spill out of all of them (DRAM, twice the
+// largest cache). The strings have no vowels, so every byte is read. A
+// kernel whose bytes per second holds steady across the levels is compute
+// bound; where it drops, it is bound by that level's bandwidth, and the level
+// above is the largest batch that still runs at full speed. The benchmarks
+// are labeled with the level.
+struct WorkingSet {
+  std::string level;
+  int64_t bytes;
+};
+
+static const std::vector<WorkingSet>& WorkingSets() {
+  static const auto* working_sets = [] {
+    auto* working_sets = new std::vector<WorkingSet>;
+    int64_t largest = 0;
+    for (const auto& cache : benchmark::CPUInfo::Get().caches) {
+      if (cache.type == "Instruction") continue;
+      working_sets->push_back(
+          {"L" + std::to_string(cache.level), int64_t{cache.size} / 2});
+      largest = std::max<int64_t>(largest, cache.size);
+    }
+    // google_benchmark could not read the cache sizes, so guess.
+    if (working_sets->empty()) {
+      *working_sets = {{"L1", 16 << 10}, {"L2", 512 << 10}, {"L3", 16 << 20}};
+      largest = 32 << 20;
+    }
+    std::sort(working_sets->begin(), working_sets->end(),
+              [](const WorkingSet& a, const WorkingSet& b) {
+                return a.bytes < b.bytes;
+              });
+    working_sets->push_back(
+        {"DRAM", std::max<int64_t>(2 * largest, int64_t{64} << 20)});
+    return working_sets;
+  }();
+  return *working_sets;
+}
+
+static void WorkingSetArgs(benchmark::internal::Benchmark* b) {
+  std::vector<int64_t> bytes;
+  for (const WorkingSet& working_set : WorkingSets()) {
+    bytes.push_back(working_set.bytes);
+  }
+  b->ArgNames({"bytes", "length"})->ArgsProduct({bytes, {64, 4096}});
+}
+
+// Every working set is a prefix of this one haystack, cut into strings of
+// the given length, so that there are no offsets to read alongside the
+// strings and the largest haystack is only generated once.
+REGISTER_FIXTURE(StringCorpus, WorkingSetHaystack, [](uint64_t seed) {
+  const int64_t bytes = WorkingSets().back().bytes;
+  return MakeStrings(seed, 1, FixedLengthDistribution(bytes),
+                     /*vowel_probability=*/0);
+})
+
+template <typename Kernel>
+static void RunWorkingSetBenchmark(benchmark::State& state, Kernel kernel) {
+  const std::string_view haystack =
+      WorkingSetHaystack()[0].substr(0, state.range(0));
+  const size_t length = state.range(1);
+  const auto scan = [&] {
+    for (size_t pos = 0; pos + length <= haystack.size(); pos += length) {
+      benchmark::DoNotOptimize(kernel(haystack.substr(pos, length)));
+    }
+  };
+  // One untimed pass, so that the corpus starts out in the cache it fits in.
+  scan();
+  for (auto _ : state) scan();
+  for (const WorkingSet& working_set : WorkingSets()) {
+    if (working_set.bytes == state.range(0)) state.SetLabel(working_set.level);
+  }
+  const int64_t bytes = haystack.size() / length * length;
+  state.SetBytesProcessed(state.iterations() * bytes);
+  SetHaystackBytes(state, bytes);
+}
+
+#define BENCHMARK_HAS_VOWEL_WORKING_SET(Fn, Args...)                     \
+  static void BM_##Fn##_WorkingSet(benchmark::State& state) {            \
+    RunWorkingSetBenchmark(state,                                        \
+                           [](std::string_view s) { return Fn(Args); }); \
+  }                                                                      \
+  BENCHMARK(BM_##Fn##_WorkingSet)->Apply(WorkingSetArgs);
+
+BENCHMARK_HAS_VOWEL_WORKING_SET(HasVowelLoopInterchanged, s)
+BENCHMARK_HAS_VOWEL_WORKING_SET(HasVowelSwar, s)
+BENCHMARK_HAS_VOWEL_WORKING_SET(HasVowelSwarAligned, s)
+BENCHMARK_HAS_VOWEL_WORKING_SET(HasVowelRegexEarlyReturn, s)
+BENCHMARK_HAS_VOWEL_WORKING_SET(HasVowelRegexInterleaved4, s)
+BENCHMARK_HAS_VOWEL_WORKING_SET(HasVowelSimd, s)
+BENCHMARK_HAS_VOWEL_WORKING_SET(HasAnyOfNibble, s, kVowelNibbleTables)
+
+// A single haystack larger than most last-level caches, streamed through a
+// reusable buffer the way a read() loop would. The chunk size trades the
+// per-chunk overhead against the buffer falling out of L1/L2 between the copy
+// and the scan.
+static constexpr size_t kStreamBytes = 64 << 20;
+
+REGISTER_FIXTURE(StringCorpus, StreamHaystack, [](uint64_t seed) {
+  return MakeStrings(seed, 1, FixedLengthDistribution(kStreamBytes),
+                     /*vowel_probability=*/0);
+})
+
+static void BM_StreamingScanner(benchmark::State& state,
+                                bool (VowelScanner::*scan)(std::string_view)) {
+  const std::string_view haystack = StreamHaystack()[0];
+  std::vector<char> buffer(state.range(0));
+  for (auto _ : state) {
+    VowelScanner scanner;
+    for (size_t pos = 0; pos < haystack.size(); pos += buffer.size()) {
+      const size_t n = std::min(buffer.size(), haystack.size() - pos);
+      std::memcpy(buffer.data(), haystack.data() + pos, n);
+      if ((scanner.*scan)({buffer.data(), n})) break;
+    }
+    benchmark::DoNotOptimize(scanner.matched());
+  }
+  state.SetBytesProcessed(state.iterations() * haystack.size());
+  SetHaystackBytes(state, haystack.size());
+}
+
+BENCHMARK_CAPTURE(BM_StreamingScanner, Dfa, &VowelScanner::Scan)
+    ->ArgName("chunk")
+    ->RangeMultiplier(4)
+    ->Range(4 << 10, 16 << 20);
+BENCHMARK_CAPTURE(BM_StreamingScanner, Simd, &VowelScanner::ScanSimd)
+    ->ArgName("chunk")
+    ->RangeMultiplier(4)
+    ->Range(4 << 10, 16 << 20);
+
+// Kernels over the lines of --corpus_file. The cache argument says where the
+// file's pages are when an iteration starts:
+//   kResident: mapped and faulted in once, before the timing starts.
+//   kWarm:     in the page cache; every iteration maps the file again and
+//              takes a minor fault per page (unless populate is set).
+//   kCold:     evicted from the page cache before every iteration, so every
+//              page is read from disk.
+// In the last two modes mmap and munmap are timed along with the scan. Real
+// time is reported, since time spent waiting for the disk is not CPU time.
+enum FileCache { kResident, kWarm, kCold };
+
+static void FileArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"cache", "populate", "sequential"});
+  b->Args({kResident, 1, 0});
+  for (int cache : {kWarm, kCold}) {
+    b->ArgsProduct({{cache}, {0, 1}, {0, 1}});
+  }
+  b->UseRealTime();
+}
+
+template <typename Kernel>
+static void RunFileBenchmark(benchmark::State& state, Kernel kernel) {
+  const std::string path = absl::GetFlag(FLAGS_corpus_file);
+  if (path.empty()) {
+    state.SkipWithError("no --corpus_file");
+    return;
+  }
+  const std::vector<Line>& lines = FileLines();
+  const auto cache = static_cast<FileCache>(state.range(0));
+  const MappedFile::Options options = {.populate = state.range(1) != 0,
+                                       .sequential = state.range(2) != 0};
+
+  std::unique_ptr<MappedFile> file;
+  if (cache == kResident) file = MappedFile::Open(path, options);
+  for (auto _ : state) {
+    if (cache == kCold) {
+      state.PauseTiming();
+      const bool evicted = charscan::EvictFromPageCache(path);
+      state.ResumeTiming();
+      if (!evicted) {
+        state.SkipWithError("cannot evict --corpus_file from the page cache");
+        break;
+      }
+    }
+    if (cache != kResident) file = MappedFile::Open(path, options);
+    if (file == nullptr) {
+      state.SkipWithError("cannot map --corpus_file");
+      break;
+    }
+    const char* data = file->contents().data();
+    for (Line line : lines) {
+      benchmark::DoNotOptimize(kernel({data + line.offset, line.size}));
+    }
+    if (cache != kResident) file = nullptr;
+  }
+
+  int64_t bytes = 0;
+  for (Line line : lines) bytes += line.size;
+  state.SetBytesProcessed(state.iterations() * bytes);
+  SetHaystackBytes(state, bytes);
+}
+
+#define BENCHMARK_HAS_VOWEL_FILE(Fn, Args...)                             \
+  static void BM_##Fn##_File(benchmark::State& state) {                   \
+    RunFileBenchmark(state, [](std::string_view s) { return Fn(Args); }); \
+  }                                                                       \
+  BENCHMARK(BM_##Fn##_File)->Apply(FileArgs);
+
+BENCHMARK_HAS_VOWEL_FILE(HasVowelLoopInterchanged, s)
+BENCHMARK_HAS_VOWEL_FILE(HasVowelSwar, s)
+BENCHMARK_HAS_VOWEL_FILE(HasVowelRegexEarlyReturn, s)
+BENCHMARK_HAS_VOWEL_FILE(HasVowelSimd, s)
+BENCHMARK_HAS_VOWEL_FILE(HasAnyOfNibble, s, kVowelNibbleTables)
+
+// A single haystack far larger than the LongStringDistribution strings, for
+// the parallel kernels. BlobWithVowel has one vowel, in the middle, so that a
+// parallel scan can cancel about halfway through.
+static constexpr size_t kBlobBytes = 256 << 20;
+
+REGISTER_FIXTURE(StringCorpus, Blob, [](uint64_t seed) {
+  return MakeStrings(seed, 1, FixedLengthDistribution(kBlobBytes),
+                     /*vowel_probability=*/0);
+})
+REGISTER_FIXTURE(StringCorpus, BlobWithVowel, [](uint64_t seed) {
+  return MakeStrings(seed, 1, FixedLengthDistribution(kBlobBytes),
+                     /*vowel_probability=*/0, /*first_vowel=*/kBlobBytes / 2);
+})
+
+// 1, 2, 4, ... cores, up to and including every core.
+template <typename Apply>
+static void ForEachCoreCount(Apply apply) {
+  const int max_threads = std::max(1u, std::thread::hardware_concurrency());
+  for (int n = 1; n < max_threads; n *= 2) apply(n);
+  apply(max_threads);
+}
+
+static void BM_HasAnyOfNibbleParallel(benchmark::State& state,
+                                      const StringCorpus& (*blob)()) {
+  const std::string_view haystack = (*blob)()[0];
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(charscan::HasAnyOfNibbleParallel(
+        haystack, kVowelNibbleTables, state.range(0)));
+  }
+  state.SetBytesProcessed(state.iterations() * haystack.size());
+  SetHaystackBytes(state, haystack.size());
+}
+
+BENCHMARK_CAPTURE(BM_HasAnyOfNibbleParallel, Blob, Blob)
+    ->ArgName("threads")
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      ForEachCoreCount([&](int n) { b->Arg(n); });
+    })
+    ->UseRealTime();
+BENCHMARK_CAPTURE(BM_HasAnyOfNibbleParallel, BlobWithVowel, BlobWithVowel)
+    ->ArgName("threads")
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      ForEachCoreCount([&](int n) { b->Arg(n); });
+    })
+    ->UseRealTime();
+
+// The memory bandwidth ceiling: each benchmark thread scans its own slice of
+// the blob with the single-threaded kernel, with no work stealing or
+// cancellation. Where this stops scaling, the parallel kernel cannot scale
+// either.
+static void BM_HasAnyOfNibbleBlobSlices(benchmark::State& state) {
+  const std::string_view blob = Blob()[0];
+  const size_t slice = blob.size() / state.threads();
+  const std::string_view haystack =
+      blob.substr(state.thread_index() * slice, slice);
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(HasAnyOfNibble(haystack, kVowelNibbleTables));
+  }
+  state.SetBytesProcessed(state.iterations() * haystack.size());
+}
+
+BENCHMARK(BM_HasAnyOfNibbleBlobSlices)
+    ->Apply([](benchmark::internal::Benchmark* b) {
+      ForEachCoreCount([&](int n) { b->Threads(n); });
+    })
+    ->UseRealTime();
+
+// Multithreaded throughput. Each benchmark thread scans its own slice of a
+// shared corpus with a single-threaded kernel, and the bytes per second are
+// the total over all threads, so the point where they stop growing with the
+// thread count is where the machine saturates. The arguments:
+//   pin:   pin thread i to the i-th CPU the process may run on. CPUs are
+//          numbered socket by socket on most machines, so past one socket's
+//          worth of threads, the rest run on the next socket.
+//   local: each thread copies its slice after pinning, so that the pages are
+//          first touched, and so allocated, on its own NUMA node. Otherwise
+//          every slice stays wherever the corpus was built.
+static const std::vector<int>& AllowedCpus() {
+  static const auto* cpus = [] {
+    auto* cpus = new std::vector<int>;
+#ifdef __linux__
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+      for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+        if (CPU_ISSET(cpu, &set)) cpus->push_back(cpu);
+      }
+    }
+#endif
+    if (cpus->empty()) {
+      for (unsigned cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu) {
+        cpus->push_back(cpu);
+      }
+    }
+    return cpus;
+  }();
+  return *cpus;
+}
+
+// Pins the calling thread to one CPU, and restores its affinity on
+// destruction: google_benchmark runs thread 0 on the main thread, which goes
+// on to run the other benchmarks.
+class ScopedCpuPin {
+ public:
+  explicit ScopedCpuPin(int cpu) {
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pinned_ = sched_getaffinity(0, sizeof(previous_), &previous_) == 0 &&
+              sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    (void)cpu;
+#endif
+  }
+
+  ScopedCpuPin(const ScopedCpuPin&) = delete;
+  ScopedCpuPin& operator=(const ScopedCpuPin&) = delete;
+
+  ~ScopedCpuPin() {
+#ifdef __linux__
+    if (pinned_) sched_setaffinity(0, sizeof(previous_), &previous_);
+#endif
+  }
+
+  bool pinned() const { return pinned_; }
+
+ private:
+  bool pinned_ = false;
+#ifdef __linux__
+  cpu_set_t previous_;
+#endif
+};
+
+static void ThreadArgs(benchmark::internal::Benchmark* b) {
+  b->ArgNames({"pin", "local"})
+      ->Args({0, 0})
+      ->Args({1, 0})
+      ->Args({1, 1})
+      ->ThreadRange(1, AllowedCpus().size())
+      ->UseRealTime();
+}
+
+template <typename Kernel>
+static void RunThreadsBenchmark(benchmark::State& state, bool supported,
+                                const StringCorpus& strs, Kernel kernel) {
+  const bool pin = state.range(0) != 0;
+  const bool local = state.range(1) != 0;
+  std::optional<ScopedCpuPin> pinned;
+  if (!supported) {
+    state.SkipWithError("unsupported CPU");
+  } else if (pin) {
+    const std::vector<int>& cpus = AllowedCpus();
+    pinned.emplace(cpus[state.thread_index() % cpus.size()]);
+    // No early return: every thread must reach the benchmark loop, where the
+    // others wait for it at google_benchmark's start barrier. A skipped
+    // thread runs no iterations there.
+    if (!pinned->pinned()) state.SkipWithError("cannot pin threads");
+  }
+
+  size_t begin = strs.size() * state.thread_index() / state.threads();
+  size_t end = strs.size() * (state.thread_index() + 1) / state.threads();
+  StringCorpus local_slice;
+  if (local) {
+    std::vector<std::string_view> slice;
+    for (size_t i = begin; i < end; ++i) slice.push_back(strs[i]);
+    local_slice = StringCorpus(slice);
+    begin = 0;
+    end = local_slice.size();
+  }
+  const StringCorpus& corpus = local ? local_slice : strs;
+
+  for (auto _ : state) {
+    for (size_t i = begin; i < end; ++i) {
+      benchmark::DoNotOptimize(kernel(corpus[i]));
+    }
+  }
+  // The bytes up to and including the first vowel, which is what an
+  // early-exit kernel reads.
+  int64_t bytes = 0;
+  for (size_t i = begin; i < end; ++i) {
+    const size_t vowel = corpus[i].find_first_of(kVowels);
+    bytes += vowel == std::string_view::npos ? corpus[i].size() : vowel + 1;
+  }
+  state.SetItemsProcessed(state.iterations() * (end - begin));
+  state.SetBytesProcessed(state.iterations() * bytes);
+}
+
+// As BENCHMARK_HAS_VOWEL_IF, the kernel is only run where Supported.
+#define BENCHMARK_HAS_VOWEL_THREADS_IF(Supported, Fn, Data, Args...)   \
+  static void BM_##Fn##_##Data##_Threads(benchmark::State& state) {    \
+    RunThreadsBenchmark(state, Supported, Data(),                      \
+                        [](std::string_view s) { return Fn(Args); });  \
+  }                                                                    \
+  BENCHMARK(BM_##Fn##_##Data##_Threads)->Apply(ThreadArgs);
+
+#define BENCHMARK_HAS_VOWEL_THREADS(Fn, Data, Args...) \
+  BENCHMARK_HAS_VOWEL_THREADS_IF(true, Fn, Data, Args)
+
+#if defined(__x86_64__) || defined(__i386__)
+#define BENCHMARK_HAS_VOWEL_THREADS_ARCH(Data)                                \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelSse2, Data, s)                          \
+  BENCHMARK_HAS_VOWEL_THREADS_IF(CpuHasAvx2(), HasVowelAvx2, Data, s)         \
+  BENCHMARK_HAS_VOWEL_THREADS_IF(CpuHasSsse3(), HasAnyOfNibbleSsse3, Data, s, \
+                                 kVowelNibbleTables)                          \
+  BENCHMARK_HAS_VOWEL_THREADS_IF(CpuHasAvx2(), HasAnyOfNibbleAvx2, Data, s,   \
+                                 kVowelNibbleTables)
+#elif defined(__aarch64__)
+#define BENCHMARK_HAS_VOWEL_THREADS_ARCH(Data)        \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelNeon, Data, s) \
+  BENCHMARK_HAS_VOWEL_THREADS(HasAnyOfNibbleNeon, Data, s, kVowelNibbleTables)
+#else
+#define BENCHMARK_HAS_VOWEL_THREADS_ARCH(Data)
+#endif
+
+// Every per-string kernel of the single-threaded matrix above, and the
+// library baselines. That is a large matrix; pick from it with
+// --benchmark_filter, e.g. 'LongNoVowels_Threads'. HasVowelBatch is left
+// out, since it answers a whole corpus per call rather than a string.
+#define BENCHMARK_HAS_VOWEL_THREADS_ALL(Data)                               \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelLoop, Data, s)                        \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelLoopInterchanged, Data, s)            \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelSwar, Data, s)                        \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelSwarAligned, Data, s)                 \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelRegex, Data, s)                       \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelRegexEarlyReturn, Data, s)            \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelRegexInt, Data, s)                    \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelRegexClasses, Data, s)                \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelRegexClassesEarlyReturn, Data, s)     \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelRegexInterleaved1, Data, s)           \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelRegexInterleaved2, Data, s)           \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelRegexInterleaved4, Data, s)           \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelRegexInterleaved8, Data, s)           \
+  BENCHMARK_HAS_VOWEL_THREADS_ARCH(Data)                                    \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelSimd, Data, s)                        \
+  BENCHMARK_HAS_VOWEL_THREADS(HasAnyOfNibble, Data, s, kVowelNibbleTables)  \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelFindFirstOf, Data, s)                 \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelMemchr, Data, s)                      \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelStrContains, Data, s)                 \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelAbslCharSet, Data, s)                 \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelStdRegex, Data, s)                    \
+  BENCHMARK_HAS_VOWEL_THREADS(HasVowelRe2, Data, s)
+
+BENCHMARK_HAS_VOWEL_THREADS_ALL(ShortWithVowels)
+BENCHMARK_HAS_VOWEL_THREADS_ALL(ShortNoVowels)
+BENCHMARK_HAS_VOWEL_THREADS_ALL(LongWithVowels)
+BENCHMARK_HAS_VOWEL_THREADS_ALL(LongNoVowels)
+
+// Cost of the nibble classifier as a function of the set size. None of these
+// bytes occur in LongNoVowels, so every string is scanned to the end.
+static constexpr std::string_view kNonAlnum =
+    "!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"
+    "\x01\x02\x03\x04\x05\x06\x07\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f\x10"
+    "\x11\x12\x13\x14\x15\x16\x17\x18\x19\x1a\x1b\x1c\x1d\x1e\x1f\x7f";
+
+static void BM_HasAnyOfNibble_SetSize(benchmark::State& state) {
+  const NibbleTables tables =
+      MakeNibbleTables(kNonAlnum.substr(0, state.range(0)));
+  const auto& strs = LongNoVowels();
+  for (auto _ : state) {
+    for (std::string_view s : strs) {
+      benchmark::DoNotOptimize(HasAnyOfNibble(s, tables));
+    }
+  }
+}
+BENCHMARK(BM_HasAnyOfNibble_SetSize)->RangeMultiplier(4)->Range(1, 64);
+
+// Every matching strategy over character sets of different sizes and
+// densities. Benchmark names are BM_HasAnyOf<Name>_<Strategy>_<Data>, where
+// k<Name>Set is the character set.
+static constexpr CharSet kNewlineSet = "\n";
+static constexpr CharSet kDelimiterSet = ",;|\t";
+static constexpr CharSet kWhitespaceSet = " \t\n\v\f\r";
+static constexpr CharSet kDigitSet = "0123456789";
+static constexpr CharSet kPunctuationSet =
+    "!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~";
+
+#define BENCHMARK_CHAR_SET_KERNEL(Name, Kernel, Data, Call...)                 \
+  static void BM_HasAnyOf##Name##_##Kernel##_##Data(benchmark::State& state) { \
+    const auto& strs = Data();                                                 \
+    for (auto _ : state) {                                                     \
+      for (std::string_view s : strs) benchmark::DoNotOptimize(Call);          \
+    }                                                                          \
+  }                                                                            \
+                                                                               \
+  BENCHMARK(BM_HasAnyOf##Name##_##Kernel##_##Data);
+
+#define BENCHMARK_CHAR_SET(Name, Data)                                       \
+  BENCHMARK_CHAR_SET_KERNEL(Name, Loop, Data, HasAnyOfLoop<k##Name##Set>(s)) \
+  BENCHMARK_CHAR_SET_KERNEL(                                                 \
+      Name, CompareChain, Data,                                              \
+      HasAnyOfLoopInterchanged<k##Name##Set, MatchStrategy::kCompareChain>(  \
+          s))                                                                \
+  BENCHMARK_CHAR_SET_KERNEL(                                                 \
+      Name, Bitmask, Data,                                                   \
+      HasAnyOfLoopInterchanged<k##Name##Set, MatchStrategy::kBitmask>(s))    \
+  BENCHMARK_CHAR_SET_KERNEL(                                                 \
+      Name, Table, Data,                                                     \
+      HasAnyOfLoopInterchanged<k##Name##Set, MatchStrategy::kTable>(s))      \
+  BENCHMARK_CHAR_SET_KERNEL(Name, Default, Data,                             \
+                            HasAnyOfLoopInterchanged<k##Name##Set>(s))       \
+  BENCHMARK_CHAR_SET_KERNEL(Name, Swar, Data,                                \
+                            HasAnyOfSwar<k##Name##Set>(s))                   \
+  BENCHMARK_CHAR_SET_KERNEL(Name, Nibble, Data,                              \
+                            HasAnyOfNibble(s, kNibbleTablesOf<k##Name##Set>))
+
+BENCHMARK_CHAR_SET(Newline, ShortNoVowels)
+BENCHMARK_CHAR_SET(Delimiter, ShortNoVowels)
+BENCHMARK_CHAR_SET(Whitespace, ShortNoVowels)
+BENCHMARK_CHAR_SET(Digit, ShortNoVowels)
+BENCHMARK_CHAR_SET(Vowel, ShortNoVowels)
+BENCHMARK_CHAR_SET(Punctuation, ShortNoVowels)
+
+BENCHMARK_CHAR_SET(Newline, LongNoVowels)
+BENCHMARK_CHAR_SET(Delimiter, LongNoVowels)
+BENCHMARK_CHAR_SET(Whitespace, LongNoVowels)
+BENCHMARK_CHAR_SET(Digit, LongNoVowels)
+BENCHMARK_CHAR_SET(Vowel, LongNoVowels)
+BENCHMARK_CHAR_SET(Punctuation, LongNoVowels)
+
+// Multi-needle search: does the string contain any of the first `needles`
+// entries of Needles()? Each needle has a vowel, so none of them occur in the
+// NoVowels datasets and every string is scanned to the end.
+REGISTER_FIXTURE(std::vector<std::string>, Needles, [](uint64_t seed) {
+  static constexpr int kMaxNeedles = 1'000;
+  std::mt19937 rng(seed);
+  std::uniform_int_distribution<> length_dist(3, 8);
+  std::uniform_int_distribution<> char_dist(0, kCharsWithVowels.size() - 1);
+  std::uniform_int_distribution<> vowel_dist(0, kVowels.size() - 1);
+  std::vector<std::string> needles(kMaxNeedles);
+  for (std::string& needle : needles) {
+    needle.resize(length_dist(rng));
+    for (char& c : needle) {
+      c = kCharsWithVowels[char_dist(rng)];
+    }
+    std::uniform_int_distribution<> pos_dist(0, needle.size() - 1);
+    needle[pos_dist(rng)] = kVowels[vowel_dist(rng)];
+  }
+  return needles;
+})
+
+// The obvious baselines: one find per needle, and RE2 on the alternation.
+class NaiveSearcher {
+ public:
+  explicit NaiveSearcher(std::span<const std::string_view> needles)
+      : needles_(needles.begin(), needles.end()) {}
+
+  bool ContainsAny(std::string_view haystack) const {
+    for (std::string_view needle : needles_) {
+      if (haystack.find(needle) != std::string_view::npos) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+ private:
+  std::vector<std::string_view> needles_;
+};
+
+class Re2Searcher {
+ public:
+  explicit Re2Searcher(std::span<const std::string_view> needles)
+      : re_(Alternation(needles), Options()) {}
+
+  bool ContainsAny(std::string_view haystack) const {
+    return RE2::PartialMatch(haystack, re_);
+  }
+
+ private:
+  static std::string Alternation(std::span<const std::string_view> needles) {
+    std::string pattern;
+    for (std::string_view needle : needles) {
+      if (!pattern.empty()) pattern += '|';
+      pattern += RE2::QuoteMeta(needle);
+    }
+    return pattern;
+  }
+
+  // The default 8 MiB is not enough for the DFA of 1000 needles.
+  static RE2::Options Options() {
+    RE2::Options options;
+    options.set_max_mem(256 << 20);
+    return options;
+  }
+
+  RE2 re_;
+};
+
+template <typename Searcher>
+static void RunMultiNeedle(benchmark::State& state, const StringCorpus& strs) {
+  const std::vector<std::string>& all = Needles();
+  const std::vector<std::string_view> needles(all.begin(),
+                                              all.begin() + state.range(0));
+  const Searcher searcher(needles);
+  for (auto _ : state) {
+    for (std::string_view s : strs) {
+      benchmark::DoNotOptimize(searcher.ContainsAny(s));
+    }
+  }
+  SetHaystackBytes(state, TotalBytes(strs));
+  state.SetBytesProcessed(state.iterations() * TotalBytes(strs));
+}
+
+#define BENCHMARK_MULTI_NEEDLE(Name, Searcher, Data)                   \
+  static void BM_MultiNeedle##Name##_##Data(benchmark::State& state) { \
+    RunMultiNeedle<Searcher>(state, Data());                           \
+  }                                                                    \
+                                                                       \
+  BENCHMARK(BM_MultiNeedle##Name##_##Data)                             \
+      ->ArgName("needles")                                             \
+      ->RangeMultiplier(10)                                            \
+      ->Range(1, 1'000);
+
+BENCHMARK_MULTI_NEEDLE(Naive, NaiveSearcher, ShortNoVowels)
+BENCHMARK_MULTI_NEEDLE(Re2, Re2Searcher, ShortNoVowels)
+BENCHMARK_MULTI_NEEDLE(AhoCorasick, charscan::AhoCorasick, ShortNoVowels)
+BENCHMARK_MULTI_NEEDLE(Teddy, charscan::Teddy, ShortNoVowels)
+
+BENCHMARK_MULTI_NEEDLE(Naive, NaiveSearcher, LongNoVowels)
+BENCHMARK_MULTI_NEEDLE(Re2, Re2Searcher, LongNoVowels)
+BENCHMARK_MULTI_NEEDLE(AhoCorasick, charscan::AhoCorasick, LongNoVowels)
+BENCHMARK_MULTI_NEEDLE(Teddy, charscan::Teddy, LongNoVowels)
+
+// Workloads that change under AdaptiveVowelMatcher. MixedPhases is the four
+// datasets one after the other, each repeated 16 times, so that the best
+// kernel changes every 16,000 strings: long enough for the matcher to notice
+// and make up for its trials. MixedInterleaved alternates them string by
+// string, so no one dataset's statistics ever show.
+static StringCorpus Interleave(size_t run, int repeat) {
+  const StringCorpus* corpora[] = {&ShortWithVowels(), &ShortNoVowels(),
+                                   &LongWithVowels(), &LongNoVowels()};
+  size_t total = 0;
+  for (const StringCorpus* corpus : corpora) total += corpus->size();
+  std::vector<std::string_view> strings;
+  for (size_t begin = 0; strings.size() < repeat * total; begin += run) {
+    for (const StringCorpus* corpus : corpora) {
+      for (int r = 0; r < repeat; ++r) {
+        for (size_t i = begin; i < std::min(begin + run, corpus->size());
+             ++i) {
+          strings.push_back((*corpus)[i]);
+        }
+      }
+    }
+  }
+  return StringCorpus(strings);
+}
+
+REGISTER_FIXTURE(StringCorpus, MixedPhases, [](uint64_t) {
+  return Interleave(kShortNumStrings, /*repeat=*/16);
+})
+REGISTER_FIXTURE(StringCorpus, MixedInterleaved,
+                 [](uint64_t) { return Interleave(1, /*repeat=*/1); })
+
+// The matcher lives across iterations, as it would in a long-running
+// service. Its decisions are reported as the share of strings each strategy
+// answered, and its trials and switches per pass over the corpus.
+static void SetAdaptiveCounters(
+    benchmark::State& state,
+    const charscan::AdaptiveVowelMatcher::Stats& stats) {
+  uint64_t total = 0;
+  for (uint64_t strings : stats.strings) total += strings;
+  for (size_t i = 0; i < charscan::kNumVowelStrategies; ++i) {
+    if (stats.strings[i] == 0) continue;
+    const auto strategy = static_cast<charscan::VowelStrategy>(i);
+    state.counters[std::string(charscan::VowelStrategyName(strategy))] =
+        static_cast<double>(stats.strings[i]) / total;
+  }
+  state.counters["trials"] = benchmark::Counter(
+      stats.trials, benchmark::Counter::kAvgIterations);
+  state.counters["switches"] = benchmark::Counter(
+      stats.switches, benchmark::Counter::kAvgIterations);
+}
+
+// Batches are bursts of kBurstStrings consecutive strings.
+static constexpr size_t kBurstStrings = 64;
+
+#define BENCHMARK_HAS_VOWEL_ADAPTIVE(Data)                               \
+  static void BM_HasVowelAdaptive_##Data(benchmark::State& state) {      \
+    const auto& strs = Data();                                           \
+    charscan::AdaptiveVowelMatcher matcher;                              \
+    for (auto _ : state) {                                               \
+      for (std::string_view s : strs) {                                  \
+        benchmark::DoNotOptimize(matcher.HasVowel(s));                   \
+      }                                                                  \
+    }                                                                    \
+    SetHaystackBytes(state, TotalBytes(strs));                           \
+    SetAdaptiveCounters(state, matcher.stats());                         \
+  }                                                                      \
+                                                                         \
+  static void BM_HasVowelAdaptiveBatch_##Data(benchmark::State& state) { \
+    const auto& strs = Data();                                           \
+    const std::vector<std::string_view> views(strs.begin(), strs.end()); \
+    std::vector<uint64_t> bits(BitVectorWords(kBurstStrings));           \
+    charscan::AdaptiveVowelMatcher matcher;                              \
+    for (auto _ : state) {                                               \
+      for (size_t i = 0; i < views.size(); i += kBurstStrings) {         \
+        const size_t n = std::min(kBurstStrings, views.size() - i);      \
+        matcher.HasVowelBatch(std::span(views).subspan(i, n), bits);     \
+        benchmark::DoNotOptimize(bits.data());                           \
+        benchmark::ClobberMemory();                                      \
+      }                                                                  \
+    }                                                                    \
+    SetHaystackBytes(state, TotalBytes(strs));                           \
+    SetAdaptiveCounters(state, matcher.stats());                         \
+  }                                                                      \
+                                                                         \
+  BENCHMARK(BM_HasVowelAdaptive_##Data);                                 \
+  BENCHMARK(BM_HasVowelAdaptiveBatch_##Data);
+
+BENCHMARK_HAS_VOWEL_ADAPTIVE(ShortWithVowels)
+BENCHMARK_HAS_VOWEL_ADAPTIVE(ShortNoVowels)
+BENCHMARK_HAS_VOWEL_ADAPTIVE(LongWithVowels)
+BENCHMARK_HAS_VOWEL_ADAPTIVE(LongNoVowels)
+
+BENCHMARK_HAS_VOWEL(HasVowelLoopInterchanged, MixedPhases, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwar, MixedPhases, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, MixedPhases, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, MixedPhases, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_BATCH(HasVowelBatch, MixedPhases)
+BENCHMARK_HAS_VOWEL_ADAPTIVE(MixedPhases)
+
+BENCHMARK_HAS_VOWEL(HasVowelLoopInterchanged, MixedInterleaved, s)
+BENCHMARK_HAS_VOWEL(HasVowelSwar, MixedInterleaved, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, MixedInterleaved, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, MixedInterleaved, s, kVowelNibbleTables)
+BENCHMARK_HAS_VOWEL_BATCH(HasVowelBatch, MixedInterleaved)
+BENCHMARK_HAS_VOWEL_ADAPTIVE(MixedInterleaved)
+
+// UTF-8 text, long strings, from all ASCII to nearly none: 2% non-ASCII
+// characters is about what Western European languages use, and Utf8Cyrillic
+// is 5% ASCII, like the spaces and digits of Russian. None has a vowel but
+// Utf8LatinWithVowels, which has accented ones only. HasAnyOfNibble looks for
+// the ASCII vowels alone, so on these it is the speed to aim for rather than
+// a correct answer.
+#define REGISTER_UTF8_CORPUS(Name, NonAsciiProbability, VowelProbability) \
+  REGISTER_FIXTURE(StringCorpus, Name, [](uint64_t seed) {                \
+    return MakeUtf8Strings(seed, kLongNumStrings, LongStringDistribution, \
+                           NonAsciiProbability, VowelProbability);        \
+  })
+
+REGISTER_UTF8_CORPUS(Utf8Ascii, 0, 0)
+REGISTER_UTF8_CORPUS(Utf8Latin, 0.02, 0)
+REGISTER_UTF8_CORPUS(Utf8Mixed, 0.3, 0)
+REGISTER_UTF8_CORPUS(Utf8Cyrillic, 0.95, 0)
+REGISTER_UTF8_CORPUS(Utf8LatinWithVowels, 0.02, 0.0005)
+
+#define BENCHMARK_HAS_VOWEL_UTF8(Data)                             \
+  BENCHMARK_HAS_VOWEL(HasVowelUtf8, Data, s)                       \
+  BENCHMARK_HAS_VOWEL(HasVowelUtf8Dfa, Data, s)                    \
+  BENCHMARK_HAS_VOWEL(HasVowelRegexClassesEarlyReturn, Data, s)    \
+  BENCHMARK_HAS_VOWEL(HasAnyOfNibble, Data, s, kVowelNibbleTables)
+
+BENCHMARK_HAS_VOWEL_UTF8(Utf8Ascii)
+BENCHMARK_HAS_VOWEL_UTF8(Utf8Latin)
+BENCHMARK_HAS_VOWEL_UTF8(Utf8Mixed)
+BENCHMARK_HAS_VOWEL_UTF8(Utf8Cyrillic)
+BENCHMARK_HAS_VOWEL_UTF8(Utf8LatinWithVowels)
+
+// An append-only buffer that is asked whether it has a vowel yet after every
+// append of `append` bytes, until it holds `bytes`. Rescanning the whole
+// buffer each time is quadratic overall, so it only gets the smaller sizes;
+// the incremental strings read each new byte once. The text has no vowels,
+// so nothing stops early.
+static constexpr size_t kAppendBytes = 1 << 20;
+
+REGISTER_FIXTURE(StringCorpus, AppendText, [](uint64_t seed) {
+  return MakeStrings(seed, 1, FixedLengthDistribution(kAppendBytes),
+                     /*vowel_probability=*/0);
+})
+
+template <bool (*Fn)(std::string_view)>
+class RescanString {
+ public:
+  void Append(std::string_view s) { bytes_.append(s); }
+  bool HasAny() const { return Fn(bytes_); }
+
+ private:
+  std::string bytes_;
+};
+
+template <typename Buffer>
+static void RunAppendBenchmark(benchmark::State& state) {
+  const std::string_view text = AppendText()[0].substr(0, state.range(0));
+  const size_t append = state.range(1);
+  for (auto _ : state) {
+    Buffer buffer;
+    for (size_t pos = 0; pos < text.size(); pos += append) {
+      buffer.Append(text.substr(pos, append));
+      benchmark::DoNotOptimize(buffer.HasAny());
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * (text.size() / append));
+  state.SetBytesProcessed(state.iterations() * text.size());
+}
+
+static void BM_AppendRescanRegex(benchmark::State& state) {
+  RunAppendBenchmark<RescanString<HasVowelRegexEarlyReturn>>(state);
+}
+static void BM_AppendRescanSimd(benchmark::State& state) {
+  RunAppendBenchmark<RescanString<HasVowelSimd>>(state);
+}
+static void BM_AppendChunked(benchmark::State& state) {
+  RunAppendBenchmark<VowelChunkedString>(state);
+}
+static void BM_AppendSegmentTree(benchmark::State& state) {
+  RunAppendBenchmark<VowelSegmentTree>(state);
+}
+BENCHMARK(BM_AppendRescanRegex)
+    ->ArgNames({"bytes", "append"})
+    ->ArgsProduct({{4 << 10, 64 << 10}, {16, 256}});
+BENCHMARK(BM_AppendRescanSimd)
+    ->ArgNames({"bytes", "append"})
+    ->ArgsProduct({{4 << 10, 64 << 10}, {16, 256}});
+BENCHMARK(BM_AppendChunked)
+    ->ArgNames({"bytes", "append"})
+    ->ArgsProduct({{4 << 10, 64 << 10, kAppendBytes}, {16, 256}});
+BENCHMARK(BM_AppendSegmentTree)
+    ->ArgNames({"bytes", "append"})
+    ->ArgsProduct({{4 << 10, 64 << 10, kAppendBytes}, {16, 256}});
+
+// "Is there a vowel in [begin, end)" for random ranges of at most `length`
+// bytes of a 1 MiB string with a vowel every 100 KiB or so, against scanning
+// the range.
+REGISTER_FIXTURE(StringCorpus, RangeText, [](uint64_t seed) {
+  return MakeStrings(seed, 1, FixedLengthDistribution(kAppendBytes),
+                     /*vowel_probability=*/1e-5);
+})
+
+REGISTER_FIXTURE(VowelSegmentTree, RangeTree, [](uint64_t) {
+  VowelSegmentTree tree;
+  tree.Append(RangeText()[0]);
+  return tree;
+})
+
+template <typename Kernel>
+static void RunRangeBenchmark(benchmark::State& state, Kernel kernel) {
+  static constexpr int kQueries = 1024;
+  const size_t length = state.range(0);
+  std::mt19937 rng(42);
+  std::uniform_int_distribution<size_t> begin_dist(0, kAppendBytes - length);
+  std::uniform_int_distribution<size_t> length_dist(0, length);
+  std::vector<std::pair<size_t, size_t>> ranges;
+  for (int i = 0; i < kQueries; ++i) {
+    const size_t begin = begin_dist(rng);
+    ranges.emplace_back(begin, begin + length_dist(rng));
+  }
+  for (auto _ : state) {
+    for (const auto& [begin, end] : ranges) {
+      benchmark::DoNotOptimize(kernel(begin, end));
+    }
+  }
+  state.SetItemsProcessed(state.iterations() * kQueries);
+}
+
+static void BM_RangeRescanRegex(benchmark::State& state) {
+  const std::string_view text = RangeText()[0];
+  RunRangeBenchmark(state, [&](size_t begin, size_t end) {
+    return HasVowelRegexEarlyReturn(text.substr(begin, end - begin));
+  });
+}
+static void BM_RangeRescanSimd(benchmark::State& state) {
+  const std::string_view text = RangeText()[0];
+  RunRangeBenchmark(state, [&](size_t begin, size_t end) {
+    return HasVowelSimd(text.substr(begin, end - begin));
+  });
+}
+static void BM_RangeSegmentTree(benchmark::State& state) {
+  const VowelSegmentTree& tree = RangeTree();
+  RunRangeBenchmark(state, [&](size_t begin, size_t end) {
+    return tree.AnyIn(begin, end);
+  });
+}
+BENCHMARK(BM_RangeRescanRegex)->RangeMultiplier(16)->Range(64, kAppendBytes);
+BENCHMARK(BM_RangeRescanSimd)->RangeMultiplier(16)->Range(64, kAppendBytes);
+BENCHMARK(BM_RangeSegmentTree)->RangeMultiplier(16)->Range(64, kAppendBytes);
+
+// Short keys that repeat: 10'000 distinct ones, Zipfian with exponent 1, so
+// that a cache of a few thousand entries gets most of them.
+REGISTER_FIXTURE(StringCorpus, ZipfShort, [](uint64_t seed) {
+  return MakeZipfStrings(seed, kShortNumStrings, 10'000, 1.0,
+                         ShortStringDistribution, kUniformVowelProbability);
+})
+
+BENCHMARK_HAS_VOWEL(HasVowelRegexEarlyReturn, ZipfShort, s)
+BENCHMARK_HAS_VOWEL(HasVowelSimd, ZipfShort, s)
+BENCHMARK_HAS_VOWEL(HasAnyOfNibble, ZipfShort, s, kVowelNibbleTables)
+
+// The cache is filled by an untimed pass, and hit_rate is what a second one
+// finds in it.
+static void BM_ResultCache_ZipfShort(benchmark::State& state) {
+  const StringCorpus& strs = ZipfShort();
+  ResultCache cache(HasVowelSimd, state.range(0));
+  for (std::string_view s : strs) cache.Get(s);
+  int64_t hits = 0;
+  for (std::string_view s : strs) hits += cache.Lookup(s).has_value();
+  for (auto _ : state) {
+    for (std::string_view s : strs) benchmark::DoNotOptimize(cache.Get(s));
+  }
+  state.counters["hit_rate"] = static_cast<double>(hits) / std::size(strs);
+  state.SetItemsProcessed(state.iterations() * std::size(strs));
+}
+BENCHMARK(BM_ResultCache_ZipfShort)->ArgName("slots")->Range(1 << 10, 1 << 16);
+
+// What a hit and a miss cost against running the kernel, by key length, on
+// 4096 distinct keys without vowels. A hit is a Get of a key that is in the
+// cache; a miss is a Get of one that is not, so it pays for the lookup, the
+// kernel and the insert, which here always evicts. Keys longer than
+// ResultCache::kMaxKeyBytes are never cached. A hit costs about the same
+// whatever the kernel, so the cache pays off in front of the byte-at-a-time
+// kernels sooner than in front of the vector ones, if at all.
+static constexpr int kCacheKeys = 4096;
+
+static StringCorpus CacheKeys(int64_t length) {
+  return MakeStrings(/*seed=*/42, kCacheKeys, FixedLengthDistribution(length),
+                     /*vowel_probability=*/0);
+}
+
+static void BM_ResultCacheHit(benchmark::State& state) {
+  const StringCorpus keys = CacheKeys(state.range(0));
+  ResultCache cache(HasVowelSimd, 4 * kCacheKeys);
+  for (std::string_view s : keys) cache.Get(s);
+  for (auto _ : state) {
+    for (std::string_view s : keys) benchmark::DoNotOptimize(cache.Get(s));
+  }
+  state.SetItemsProcessed(state.iterations() * kCacheKeys);
+}
+
+static void BM_ResultCacheMiss(benchmark::State& state) {
+  const StringCorpus keys = CacheKeys(state.range(0));
+  ResultCache cache(HasVowelSimd, ResultCache::kProbes);
+  for (auto _ : state) {
+    for (std::string_view s : keys) benchmark::DoNotOptimize(cache.Get(s));
+  }
+  state.SetItemsProcessed(state.iterations() * kCacheKeys);
+}
+
+static void BM_ResultCacheKernel(benchmark::State& state,
+                                 ResultCache::Kernel kernel) {
+  const StringCorpus keys = CacheKeys(state.range(0));
+  for (auto _ : state) {
+    for (std::string_view s : keys) benchmark::DoNotOptimize(kernel(s));
+  }
+  state.SetItemsProcessed(state.iterations() * kCacheKeys);
+}
+
+BENCHMARK(BM_ResultCacheHit)->ArgName("length")->DenseRange(8, 48, 8);
+BENCHMARK(BM_ResultCacheMiss)->ArgName("length")->DenseRange(8, 48, 8);
+BENCHMARK_CAPTURE(BM_ResultCacheKernel, Simd, HasVowelSimd)
+    ->ArgName("length")
+    ->DenseRange(8, 48, 8);
+BENCHMARK_CAPTURE(BM_ResultCacheKernel, RegexEarlyReturn,
+                  HasVowelRegexEarlyReturn)
+    ->ArgName("length")
+    ->DenseRange(8, 48, 8);
+
+// Counters collected by default when google_benchmark is built with libpfm
+// (see .bazelrc). Pass --benchmark_perf_counters to pick others, or an empty
+// value to turn them off.
+constexpr std::array<std::string_view, 4> kDefaultPerfCounters = {
+    "CYCLES", "INSTRUCTIONS", "BRANCH-MISSES", "L1-DCACHE-LOAD-MISSES"};
+
+// Adds derived columns to the console output: IPC, every hardware counter
+// divided by the haystack bytes a benchmark recorded with SetHaystackBytes,
+// and for benchmarks that called SetHarnessBaseline, the time per string
+// (ns/string) and the same less the harness loop's share (kernel_ns).
+// Counters are passed through untouched when libpfm is unavailable.
+class PerfCounterReporter : public benchmark::ConsoleReporter {
+ public:
+  PerfCounterReporter() : ConsoleReporter(OO_Tabular) {}
+
+  void ReportRuns(const std::vector<Run>& runs) override {
+    std::vector<Run> derived = runs;
+    for (Run& run : derived) {
+      AddPerStringTimes(run);
+      AddDerivedCounters(run.counters);
+    }
+    ConsoleReporter::ReportRuns(derived);
+  }
+
+ private:
+  static void AddPerStringTimes(Run& run) {
+    const auto strings = run.counters.find("strings");
+    const auto harness = run.counters.find("harness_ns");
+    if (strings == run.counters.end() || harness == run.counters.end()) {
+      return;
+    }
+    const double per_iteration = strings->second.value;
+    run.counters.erase(strings);
+    if (per_iteration <= 0) return;
+    const double ns = run.GetAdjustedRealTime() /
+                      benchmark::GetTimeUnitMultiplier(run.time_unit) * 1e9 /
+                      per_iteration;
+    run.counters["ns/string"] = ns;
+    run.counters["kernel_ns"] = ns - harness->second.value;
+  }
+
+  static void AddDerivedCounters(benchmark::UserCounters& counters) {
+    const auto cycles = counters.find("CYCLES");
+    const auto instructions = counters.find("INSTRUCTIONS");
+    if (cycles != counters.end() && instructions != counters.end() &&
+        cycles->second.value > 0) {
+      counters["IPC"] = instructions->second.value / cycles->second.value;
+    }
+
+    const auto bytes = counters.find("bytes");
+    if (bytes == counters.end()) return;
+    const double per_iteration = bytes->second.value;
+    counters.erase(bytes);
+    if (per_iteration <= 0) return;
+    for (std::string_view name : kDefaultPerfCounters) {
+      const auto counter = counters.find(std::string(name));
+      if (counter == counters.end()) continue;
+      counters[std::string(name) + "/byte"] =
+          counter->second.value / per_iteration;
+    }
+  }
+};
+
+static bool HasFlag(int argc, char** argv, std::string_view flag) {
+  for (int i = 1; i < argc; ++i) {
+    if (std::string_view(argv[i]).starts_with(flag)) return true;
+  }
+  return false;
+}
+
+// Not benchmark_main: --corpus_seed has to be parsed after google_benchmark
+// has removed its own flags.
+int main(int argc, char** argv) {
+  // google_benchmark does not expose its flags, so the default counter list is
+  // injected as if it came from the command line.
+  std::vector<char*> args(argv, argv + argc);
+  std::string perf_counters = "--benchmark_perf_counters=";
+  for (std::string_view name : kDefaultPerfCounters) {
+    if (name != kDefaultPerfCounters.front()) perf_counters += ',';
+    perf_counters += name;
+  }
+  if (!HasFlag(argc, argv, "--benchmark_perf_counters")) {
+    args.insert(args.begin() + 1, perf_counters.data());
+  }
+  int args_size = args.size();
+  args.push_back(nullptr);
+  benchmark::Initialize(&args_size, args.data());
+  absl::ParseCommandLine(args_size, args.data());
+
+  // Other formats (--benchmark_format=json, ...) get the raw counters.
+  if (HasFlag(argc, argv, "--benchmark_format") &&
+      !HasFlag(argc, argv, "--benchmark_format=console")) {
+    benchmark::RunSpecifiedBenchmarks();
+  } else {
+    PerfCounterReporter reporter;
+    benchmark::RunSpecifiedBenchmarks(&reporter);
+  }
+  benchmark::Shutdown();
+  return 0;
+}
 
 /* Results on my M1 Mac:
 
@@ -0,0 +1,223 @@
+#include "vowels.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "charscan.h"
+#include "charset.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#elif defined(__aarch64__)
+#include <arm_neon.h>
+#endif
+
+namespace charscan {
+
+static constexpr auto& kRegexTable = kRegexTableOf<kVowelSet>;
+static_assert(kRegexTable[kReject][ByteIndex('a')] == kAccept);
+static_assert(kRegexTable[kReject][ByteIndex('b')] == kReject);
+
+CHARSCAN_TARGET_CLONES bool HasVowelLoop(std::string_view haystack) {
+  return HasAnyOfLoop<kVowelSet>(haystack);
+}
+
+CHARSCAN_TARGET_CLONES bool HasVowelLoopInterchanged(
+    std::string_view haystack) {
+  return HasAnyOfLoopInterchanged<kVowelSet, MatchStrategy::kCompareChain>(
+      haystack);
+}
+
+CHARSCAN_TARGET_CLONES bool HasVowelSwar(std::string_view haystack) {
+  return HasAnyOfSwar<kVowelSet>(haystack);
+}
+
+CHARSCAN_TARGET_CLONES bool HasVowelSwarAligned(std::string_view haystack) {
+  return HasAnyOfSwarAligned<kVowelSet>(haystack);
+}
+
+bool HasVowelRegex(std::string_view haystack) {
+  return HasAnyOfRegex<kVowelSet>(haystack);
+}
+
+bool HasVowelRegexEarlyReturn(std::string_view haystack) {
+  return HasAnyOfRegexEarlyReturn<kVowelSet>(haystack);
+}
+
+bool HasVowelRegexInt(std::string_view haystack) {
+  return HasAnyOfRegexInt<kVowelSet>(haystack);
+}
+
+bool HasVowelRegexInterleaved1(std::string_view haystack) {
+  return HasAnyOfRegexInterleaved<kVowelSet, 1>(haystack);
+}
+
+bool HasVowelRegexInterleaved2(std::string_view haystack) {
+  return HasAnyOfRegexInterleaved<kVowelSet, 2>(haystack);
+}
+
+bool HasVowelRegexInterleaved4(std::string_view haystack) {
+  return HasAnyOfRegexInterleaved<kVowelSet, 4>(haystack);
+}
+
+bool HasVowelRegexInterleaved8(std::string_view haystack) {
+  return HasAnyOfRegexInterleaved<kVowelSet, 8>(haystack);
+}
+
+bool HasVowelRegexClasses(std::string_view haystack) {
+  return HasAnyOfRegexClasses<kVowelSet>(haystack);
+}
+
+bool HasVowelRegexClassesEarlyReturn(std::string_view haystack) {
+  return HasAnyOfRegexClassesEarlyReturn<kVowelSet>(haystack);
+}
+
+bool HasVowelUtf8(std::string_view haystack) {
+  return HasAnyOfUtf8<kUtf8VowelSet>(haystack);
+}
+
+bool HasVowelUtf8Dfa(std::string_view haystack) {
+  return HasAnyOfUtf8Dfa<kUtf8VowelSet>(haystack);
+}
+
+// SIMD kernels. Each iteration compares one vector of the haystack against
+// every vowel and exits as soon as any lane matches. The last (partial) vector
+// is handled by re-loading the final full vector, which may overlap bytes that
+// were already checked; only haystacks shorter than one vector fall back to the
+// scalar loop.
+#if defined(__x86_64__) || defined(__i386__)
+static inline __m128i MatchVowelsSse2(__m128i chunk) {
+  __m128i match = _mm_setzero_si128();
+  for (char v : kVowels) {
+    match = _mm_or_si128(match, _mm_cmpeq_epi8(chunk, _mm_set1_epi8(v)));
+  }
+  return match;
+}
+
+bool HasVowelSse2(std::string_view haystack) {
+  static constexpr size_t kWidth = sizeof(__m128i);
+  if (haystack.size() < kWidth) {
+    return HasVowelLoopInterchanged(haystack);
+  }
+
+  const char* data = haystack.data();
+  const char* last = data + haystack.size() - kWidth;
+  for (; data < last; data += kWidth) {
+    __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    if (_mm_movemask_epi8(MatchVowelsSse2(chunk)) != 0) {
+      return true;
+    }
+  }
+  __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i*>(last));
+  return _mm_movemask_epi8(MatchVowelsSse2(chunk)) != 0;
+}
+
+__attribute__((target("avx2"))) static inline __m256i MatchVowelsAvx2(
+    __m256i chunk) {
+  __m256i match = _mm256_setzero_si256();
+  for (char v : kVowels) {
+    match =
+        _mm256_or_si256(match, _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(v)));
+  }
+  return match;
+}
+
+__attribute__((target("avx2"))) bool HasVowelAvx2(std::string_view haystack) {
+  static constexpr size_t kWidth = sizeof(__m256i);
+  if (haystack.size() < kWidth) {
+    return HasVowelSse2(haystack);
+  }
+
+  const char* data = haystack.data();
+  const char* last = data + haystack.size() - kWidth;
+  for (; data < last; data += kWidth) {
+    __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data));
+    if (_mm256_movemask_epi8(MatchVowelsAvx2(chunk)) != 0) {
+      return true;
+    }
+  }
+  __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(last));
+  return _mm256_movemask_epi8(MatchVowelsAvx2(chunk)) != 0;
+}
+#endif
+
+#if defined(__aarch64__)
+static inline uint8x16_t MatchVowelsNeon(uint8x16_t chunk) {
+  uint8x16_t match = vdupq_n_u8(0);
+  for (char v : kVowels) {
+    match = vorrq_u8(match, vceqq_u8(chunk, vdupq_n_u8(v)));
+  }
+  return match;
+}
+
+bool HasVowelNeon(std::string_view haystack) {
+  static constexpr size_t kWidth = sizeof(uint8x16_t);
+  if (haystack.size() < kWidth) {
+    return HasVowelLoopInterchanged(haystack);
+  }
+
+  const auto* data = reinterpret_cast<const uint8_t*>(haystack.data());
+  const auto* last = data + haystack.size() - kWidth;
+  for (; data < last; data += kWidth) {
+    if (vmaxvq_u8(MatchVowelsNeon(vld1q_u8(data))) != 0) {
+      return true;
+    }
+  }
+  return vmaxvq_u8(MatchVowelsNeon(vld1q_u8(last))) != 0;
+}
+#endif
+
+using HasVowelFn = bool (*)(std::string_view);
+
+// Picks the widest kernel the CPU supports. This is resolved once at startup,
+// so every call afterwards is a single indirect call.
+static HasVowelFn SelectHasVowelSimd() {
+#if defined(__x86_64__) || defined(__i386__)
+  return CpuHasAvx2() ? HasVowelAvx2 : HasVowelSse2;
+#elif defined(__aarch64__)
+  return HasVowelNeon;
+#else
+  return HasVowelSwar;
+#endif
+}
+
+static const HasVowelFn kHasVowelSimd = SelectHasVowelSimd();
+
+bool HasVowelSimd(std::string_view haystack) {
+  return kHasVowelSimd(haystack);
+}
+
+void HasVowelBatch(std::span<const std::string_view> haystacks,
+                   std::span<uint64_t> bits) {
+  HasAnyOfBatch(haystacks, kVowelNibbleTables, bits);
+}
+
+CHARSCAN_TARGET_CLONES size_t CountVowelsLoop(std::string_view haystack) {
+  return CountOfLoop<kVowelSet>(haystack);
+}
+
+size_t CountVowelsSimd(std::string_view haystack) {
+  return CountOfNibble(haystack, kVowelNibbleTables);
+}
+
+CHARSCAN_TARGET_CLONES size_t FindFirstVowelLoop(std::string_view haystack) {
+  return FindFirstOfLoop<kVowelSet>(haystack);
+}
+
+size_t FindFirstVowelSimd(std::string_view haystack) {
+  return FindFirstOfNibble(haystack, kVowelNibbleTables);
+}
+
+CHARSCAN_TARGET_CLONES size_t FindAllVowelsLoop(std::string_view haystack,
+                                                std::span<size_t> positions) {
+  return FindAllOfLoop<kVowelSet>(haystack, positions);
+}
+
+size_t FindAllVowelsSimd(std::string_view haystack,
+                         std::span<size_t> positions) {
+  return FindAllOfNibble(haystack, kVowelNibbleTables, positions);
+}
+
+}  // namespace charscan
@@ -0,0 +1,116 @@
+// Does a string contain a vowel? The kernels measured by
+// vowels-benchmark_test.cc, instantiated for the vowels. They are compiled
+// once, in vowels.cc, so anything that links this library runs the same
+// machine code the benchmarks measured.
+
+#ifndef VOWELS_H_
+#define VOWELS_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "charscan.h"
+#include "charset.h"
+#include "incremental.h"
+#include "utf8.h"
+
+// Built with -DCHARSCAN_MULTIVERSION (bazel --config=multiversion), the
+// portable kernels below are compiled once per instruction set in the list,
+// and the dynamic loader binds each call to the best one the CPU supports.
+// That lets the compiler's own vectorization of the plain loops use AVX2 or
+// AVX-512 in a binary that still runs on any x86-64.
+#if defined(CHARSCAN_MULTIVERSION) && defined(__x86_64__) && defined(__ELF__)
+#if defined(__clang__)
+#define CHARSCAN_TARGET_CLONES \
+  __attribute__((target_clones("default", "avx2", "avx512bw")))
+// Clang wants every declaration of a multiversioned function marked.
+#define CHARSCAN_TARGET_CLONES_DECL CHARSCAN_TARGET_CLONES
+#else
+// GCC rejects "avx512bw" as a clone (it asks for arch= instead), so the
+// closest level that includes it stands in.
+#define CHARSCAN_TARGET_CLONES \
+  __attribute__((target_clones("default", "avx2", "arch=x86-64-v4")))
+// GCC would emit a resolver in every file that sees a marked declaration,
+// referring to clones that only vowels.cc defines, so only the definitions
+// are marked.
+#define CHARSCAN_TARGET_CLONES_DECL
+#endif
+#else
+#define CHARSCAN_TARGET_CLONES
+#define CHARSCAN_TARGET_CLONES_DECL
+#endif
+
+namespace charscan {
+
+inline constexpr CharSet kVowelSet = "aeiouAEIOU";
+inline constexpr std::string_view kVowels = kVowelSet.view();
+
+inline constexpr auto& kVowelNibbleTables = kNibbleTablesOf<kVowelSet>;
+
+// Picks the widest kernel the CPU supports, once, at startup. This is the one
+// to call.
+bool HasVowelSimd(std::string_view haystack);
+
+// The alternatives, as benchmarked. See charset.h for how each works.
+CHARSCAN_TARGET_CLONES_DECL bool HasVowelLoop(std::string_view haystack);
+CHARSCAN_TARGET_CLONES_DECL bool HasVowelLoopInterchanged(
+    std::string_view haystack);
+CHARSCAN_TARGET_CLONES_DECL bool HasVowelSwar(std::string_view haystack);
+CHARSCAN_TARGET_CLONES_DECL bool HasVowelSwarAligned(
+    std::string_view haystack);
+bool HasVowelRegex(std::string_view haystack);
+bool HasVowelRegexEarlyReturn(std::string_view haystack);
+bool HasVowelRegexInt(std::string_view haystack);
+bool HasVowelRegexInterleaved1(std::string_view haystack);
+bool HasVowelRegexInterleaved2(std::string_view haystack);
+bool HasVowelRegexInterleaved4(std::string_view haystack);
+bool HasVowelRegexInterleaved8(std::string_view haystack);
+bool HasVowelRegexClasses(std::string_view haystack);
+bool HasVowelRegexClassesEarlyReturn(std::string_view haystack);
+
+// One compare per vowel and vector. Each requires the instruction set in its
+// name.
+#if defined(__x86_64__) || defined(__i386__)
+bool HasVowelSse2(std::string_view haystack);
+__attribute__((target("avx2"))) bool HasVowelAvx2(std::string_view haystack);
+#elif defined(__aarch64__)
+bool HasVowelNeon(std::string_view haystack);
+#endif
+
+// The vowels of Latin-1 and Latin Extended-A too, accented or not, in UTF-8.
+inline constexpr CharSet kUtf8VowelSet =
+    "aeiouAEIOU"
+    "àáâãäåæèéêëìíîïòóôõöøùúûüýÿ"
+    "ÀÁÂÃÄÅÆÈÉÊËÌÍÎÏÒÓÔÕÖØÙÚÛÜÝ"
+    "āăąēĕėęěīĭįıōŏőœūŭůűų"
+    "ĀĂĄĒĔĖĘĚĪĬĮİŌŎŐŒŪŬŮŰŲ";
+
+// HasAnyOfUtf8 and HasAnyOfUtf8Dfa for kUtf8VowelSet. See utf8.h.
+bool HasVowelUtf8(std::string_view haystack);
+bool HasVowelUtf8Dfa(std::string_view haystack);
+
+using VowelScanner = StreamingScanner<kVowelSet>;
+using VowelChunkedString = ChunkedString<kVowelSet>;
+using VowelSegmentTree = SegmentTreeString<kVowelSet>;
+
+// HasAnyOfBatch for the vowels.
+void HasVowelBatch(std::span<const std::string_view> haystacks,
+                   std::span<uint64_t> bits);
+
+// The counting and position-reporting kernels, with the same contracts as
+// CountOfNibble, FindFirstOfNibble and FindAllOfNibble.
+CHARSCAN_TARGET_CLONES_DECL size_t CountVowelsLoop(std::string_view haystack);
+size_t CountVowelsSimd(std::string_view haystack);
+CHARSCAN_TARGET_CLONES_DECL size_t FindFirstVowelLoop(
+    std::string_view haystack);
+size_t FindFirstVowelSimd(std::string_view haystack);
+CHARSCAN_TARGET_CLONES_DECL size_t FindAllVowelsLoop(
+    std::string_view haystack, std::span<size_t> positions);
+size_t FindAllVowelsSimd(std::string_view haystack,
+                         std::span<size_t> positions);
+
+}  // namespace charscan
+
+#endif  // VOWELS_H_
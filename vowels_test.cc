@@ -0,0 +1,521 @@
+#include "vowels.h"
+
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <span>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "adaptive.h"
+#include "charscan.h"
+#include "corpus.h"
+#include "gtest/gtest.h"
+#include "result_cache.h"
+
+namespace charscan {
+namespace {
+
+bool HasVowelReference(std::string_view haystack) {
+  return haystack.find_first_of(kVowels) != std::string_view::npos;
+}
+
+using HasVowelFn = bool (*)(std::string_view);
+
+struct Kernel {
+  const char* name;
+  HasVowelFn fn;
+  bool supported = true;
+};
+
+std::vector<Kernel> Kernels() {
+  std::vector<Kernel> kernels = {
+      {"Simd", HasVowelSimd},
+      {"Loop", HasVowelLoop},
+      {"LoopInterchanged", HasVowelLoopInterchanged},
+      {"Swar", HasVowelSwar},
+      {"SwarAligned", HasVowelSwarAligned},
+      {"Regex", HasVowelRegex},
+      {"RegexEarlyReturn", HasVowelRegexEarlyReturn},
+      {"RegexInt", HasVowelRegexInt},
+      {"RegexInterleaved1", HasVowelRegexInterleaved1},
+      {"RegexInterleaved2", HasVowelRegexInterleaved2},
+      {"RegexInterleaved4", HasVowelRegexInterleaved4},
+      {"RegexInterleaved8", HasVowelRegexInterleaved8},
+      {"RegexClasses", HasVowelRegexClasses},
+      {"RegexClassesEarlyReturn", HasVowelRegexClassesEarlyReturn},
+#if defined(__x86_64__) || defined(__i386__)
+      {"Sse2", HasVowelSse2},
+      {"Avx2", HasVowelAvx2, CpuHasAvx2()},
+#elif defined(__aarch64__)
+      {"Neon", HasVowelNeon},
+#endif
+  };
+  return kernels;
+}
+
+// Every length up to a few vectors, with at most one vowel, at every
+// position. That covers the vector heads and tails and the overlapping last
+// load of each kernel.
+std::vector<std::string> EdgeCases() {
+  std::vector<std::string> cases;
+  for (size_t length = 0; length <= 80; ++length) {
+    cases.emplace_back(length, 'x');
+    for (size_t i = 0; i < length; ++i) {
+      for (char vowel : {'a', 'U'}) {
+        std::string s(length, 'x');
+        s[i] = vowel;
+        cases.push_back(s);
+      }
+    }
+  }
+  // Bytes that are vowels with the 0x20 or 0x80 bit flipped.
+  cases.emplace_back("\x81\xc1\xe1!AE");
+  cases.emplace_back(std::string(40, '\xe1'));
+  cases.emplace_back(std::string(40, '!'));
+  return cases;
+}
+
+TEST(HasVowel, EdgeCases) {
+  for (const Kernel& kernel : Kernels()) {
+    if (!kernel.supported) {
+      continue;
+    }
+    for (const std::string& s : EdgeCases()) {
+      EXPECT_EQ(kernel.fn(s), HasVowelReference(s))
+          << kernel.name << " on \"" << s << "\"";
+    }
+  }
+}
+
+struct NibbleKernel {
+  const char* name;
+  bool (*has_any)(std::string_view, const NibbleTables&) = nullptr;
+  size_t (*find_first)(std::string_view, const NibbleTables&) = nullptr;
+  bool supported = true;
+  // Only defined for haystacks of at most kShortHaystack bytes.
+  bool short_only = false;
+};
+
+std::vector<NibbleKernel> NibbleKernels() {
+  std::vector<NibbleKernel> kernels = {
+      {.name = "HasAnyOfNibble", .has_any = HasAnyOfNibble},
+      {.name = "HasAnyOfNibbleScalar", .has_any = HasAnyOfNibbleScalar},
+      {.name = "FindFirstOfNibble", .find_first = FindFirstOfNibble},
+      {.name = "FindFirstOfNibbleScalar",
+       .find_first = FindFirstOfNibbleScalar},
+#if defined(__x86_64__) || defined(__i386__)
+      {.name = "HasAnyOfNibbleSsse3",
+       .has_any = HasAnyOfNibbleSsse3,
+       .supported = CpuHasSsse3()},
+      {.name = "HasAnyOfNibbleAvx2",
+       .has_any = HasAnyOfNibbleAvx2,
+       .supported = CpuHasAvx2()},
+      {.name = "HasAnyOfNibbleShortSsse3",
+       .has_any = HasAnyOfNibbleShortSsse3,
+       .supported = CpuHasSsse3(),
+       .short_only = true},
+      {.name = "HasAnyOfNibbleShortAvx2",
+       .has_any = HasAnyOfNibbleShortAvx2,
+       .supported = CpuHasAvx2(),
+       .short_only = true},
+      {.name = "HasAnyOfNibbleShortAvx512",
+       .has_any = HasAnyOfNibbleShortAvx512,
+       .supported = CpuHasAvx512Bw(),
+       .short_only = true},
+      {.name = "FindFirstOfNibbleSsse3",
+       .find_first = FindFirstOfNibbleSsse3,
+       .supported = CpuHasSsse3()},
+      {.name = "FindFirstOfNibbleAvx2",
+       .find_first = FindFirstOfNibbleAvx2,
+       .supported = CpuHasAvx2()},
+#elif defined(__aarch64__)
+      {.name = "HasAnyOfNibbleNeon", .has_any = HasAnyOfNibbleNeon},
+      {.name = "HasAnyOfNibbleShortNeon",
+       .has_any = HasAnyOfNibbleShortNeon,
+       .short_only = true},
+      {.name = "FindFirstOfNibbleNeon", .find_first = FindFirstOfNibbleNeon},
+#endif
+  };
+  return kernels;
+}
+
+// Three pages, of which only the middle one is accessible, so that a kernel
+// that reads outside the pages of its haystack crashes.
+class GuardedPage {
+ public:
+  GuardedPage() : size_(sysconf(_SC_PAGESIZE)) {
+    void* pages = mmap(nullptr, 3 * size_, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    EXPECT_NE(pages, MAP_FAILED);
+    pages_ = static_cast<char*>(pages);
+    EXPECT_EQ(mprotect(data(), size_, PROT_READ | PROT_WRITE), 0);
+  }
+  ~GuardedPage() { munmap(pages_, 3 * size_); }
+
+  GuardedPage(const GuardedPage&) = delete;
+  GuardedPage& operator=(const GuardedPage&) = delete;
+
+  char* data() const { return pages_ + size_; }
+  size_t size() const { return size_; }
+
+ private:
+  size_t size_;
+  char* pages_;
+};
+
+// Each kernel against std::string_view::find_first_of, for every length from
+// 0 to 130, on random sets (including '\0' and bytes above 0x7f) with no
+// match or one at every position. The haystacks are copied to the start and
+// to the end of a guarded page, where a load past the haystack within its
+// page is fine but one past the page crashes, and into the middle of it.
+TEST(NibbleKernels, EdgeCases) {
+  std::mt19937 rng(17);
+  std::vector<std::string> sets = {"aeiouAEIOU", std::string(1, '\0'), "x",
+                                   "\x80\xff", "\x7f\x80"};
+  for (int i = 0; i < 6; ++i) {
+    // Any ASCII set fits in the nibble tables.
+    std::string set;
+    for (int c = 0; c < 0x80; ++c) {
+      if (std::bernoulli_distribution(0.15)(rng)) set += static_cast<char>(c);
+    }
+    sets.push_back(set);
+  }
+
+  const std::vector<NibbleKernel> kernels = NibbleKernels();
+  GuardedPage page;
+  for (const std::string& set : sets) {
+    const NibbleTables tables = MakeNibbleTables(set);
+    std::string others;
+    for (int c = 0; c < 256; ++c) {
+      if (set.find(static_cast<char>(c)) == std::string::npos) {
+        others += static_cast<char>(c);
+      }
+    }
+    std::uniform_int_distribution<size_t> other(0, others.size() - 1);
+    std::uniform_int_distribution<size_t> member(0, set.size() - 1);
+
+    for (size_t length = 0; length <= 130; ++length) {
+      std::string base(length, '\0');
+      for (char& c : base) c = others[other(rng)];
+      std::vector<std::string> haystacks = {base};
+      for (size_t pos = 0; pos < length; ++pos) {
+        haystacks.push_back(base);
+        haystacks.back()[pos] = set[member(rng)];
+      }
+
+      for (const std::string& h : haystacks) {
+        const size_t expected = std::string_view(h).find_first_of(set);
+        for (size_t offset :
+             {size_t{0}, page.size() - length, (page.size() - length) / 2}) {
+          char* data = page.data() + offset;
+          std::copy(h.begin(), h.end(), data);
+          const std::string_view haystack(data, length);
+          for (const NibbleKernel& kernel : kernels) {
+            if (!kernel.supported ||
+                (kernel.short_only && length > kShortHaystack)) {
+              continue;
+            }
+            if (kernel.has_any != nullptr) {
+              ASSERT_EQ(kernel.has_any(haystack, tables),
+                        expected != std::string_view::npos)
+                  << kernel.name << ", length " << length << ", offset "
+                  << offset << ", first match " << expected;
+            } else {
+              ASSERT_EQ(kernel.find_first(haystack, tables), expected)
+                  << kernel.name << ", length " << length << ", offset "
+                  << offset;
+            }
+          }
+        }
+      }
+    }
+  }
+}
+
+// A match in the first, a middle, or the last block, or in none, with each
+// thread count, including more threads than blocks.
+TEST(HasAnyOfNibbleParallel, MatchesHasAnyOfNibble) {
+  const size_t size = 8 * kParallelBlockSize + kParallelBlockSize / 2;
+  std::vector<std::string> haystacks;
+  haystacks.emplace_back(size, 'x');
+  for (size_t pos : {size_t{0}, kParallelBlockSize - 1,
+                     4 * kParallelBlockSize + 7, size - kParallelBlockSize,
+                     size - 1}) {
+    std::string s(size, 'x');
+    s[pos] = 'e';
+    haystacks.push_back(s);
+  }
+  haystacks.emplace_back(2 * kParallelBlockSize, 'x');
+  haystacks.back().back() = 'A';
+  haystacks.emplace_back(100, 'x');
+  haystacks.emplace_back("");
+  for (const std::string& s : haystacks) {
+    for (int threads : {1, 2, 3, 8}) {
+      EXPECT_EQ(HasAnyOfNibbleParallel(s, kVowelNibbleTables, threads),
+                HasVowelReference(s))
+          << threads << " threads, " << s.size() << " bytes";
+    }
+  }
+}
+
+TEST(HasVowel, Corpus) {
+  // About one vowel per 2000 bytes, so that some strings have none.
+  const StringCorpus corpus =
+      MakeStrings(/*seed=*/1, 200, LongStringDistribution, 0.0005);
+  for (const Kernel& kernel : Kernels()) {
+    if (!kernel.supported) {
+      continue;
+    }
+    for (std::string_view s : corpus) {
+      EXPECT_EQ(kernel.fn(s), HasVowelReference(s)) << kernel.name;
+    }
+  }
+}
+
+TEST(HasVowelBatch, MatchesHasVowel) {
+  const StringCorpus corpus = MakeStrings(
+      /*seed=*/2, 1000, ShortStringDistribution, kUniformVowelProbability / 8);
+  const std::vector<std::string_view> haystacks(corpus.begin(), corpus.end());
+  std::vector<uint64_t> bits(BitVectorWords(haystacks.size()));
+  HasVowelBatch(haystacks, bits);
+  for (size_t i = 0; i < haystacks.size(); ++i) {
+    EXPECT_EQ((bits[i / 64] >> (i % 64)) & 1, HasVowelReference(haystacks[i]))
+        << i;
+  }
+}
+
+TEST(VowelScanner, DoesNotDependOnChunking) {
+  const std::string s = std::string(1000, 'x') + "e" + std::string(10, 'x');
+  for (size_t chunk : {1, 7, 64, 1000, 2000}) {
+    VowelScanner scanner, simd_scanner;
+    for (size_t pos = 0; pos < s.size(); pos += chunk) {
+      const std::string_view piece = std::string_view(s).substr(pos, chunk);
+      const bool seen = pos + piece.size() > 1000;
+      EXPECT_EQ(scanner.Scan(piece), seen) << chunk;
+      EXPECT_EQ(simd_scanner.ScanSimd(piece), seen) << chunk;
+    }
+  }
+}
+
+TEST(CountAndFind, MatchLoops) {
+  const StringCorpus corpus = MakeStrings(
+      /*seed=*/3, 100, LongStringDistribution, kUniformVowelProbability);
+  std::vector<size_t> loop(20'000), simd(20'000);
+  for (std::string_view s : corpus) {
+    EXPECT_EQ(CountVowelsSimd(s), CountVowelsLoop(s));
+    EXPECT_EQ(FindFirstVowelSimd(s), FindFirstVowelLoop(s));
+    const size_t n = FindAllVowelsLoop(s, loop);
+    ASSERT_EQ(FindAllVowelsSimd(s, simd), n);
+    EXPECT_TRUE(std::equal(loop.begin(), loop.begin() + n, simd.begin()));
+  }
+}
+
+// Buffers with room for fewer positions than there are vowels, so that the
+// vector kernels stop before their tail load.
+TEST(CountAndFind, TruncatedBuffers) {
+  const StringCorpus corpus = MakeStrings(
+      /*seed=*/10, 20, LongStringDistribution, kUniformVowelProbability);
+  std::vector<std::string> haystacks(corpus.begin(), corpus.end());
+  haystacks.emplace_back(100, 'a');
+  haystacks.emplace_back(std::string(33, 'x') + std::string(67, 'e'));
+  for (const std::string& s : haystacks) {
+    for (size_t size : {0, 1, 4, 17}) {
+      ASSERT_GE(CountVowelsLoop(s), size);
+      std::vector<size_t> loop(size), simd(size);
+      EXPECT_EQ(FindAllVowelsLoop(s, loop), size);
+      EXPECT_EQ(FindAllVowelsSimd(s, simd), size);
+      EXPECT_EQ(loop, simd) << size;
+    }
+  }
+}
+
+TEST(MakeStrings, FirstVowel) {
+  const StringCorpus corpus =
+      MakeStrings(/*seed=*/4, 100, FixedLengthDistribution(50),
+                  kUniformVowelProbability, /*first_vowel=*/30);
+  for (std::string_view s : corpus) {
+    EXPECT_EQ(FindFirstVowelLoop(s), 30);
+  }
+}
+
+// Whatever the matcher picks, and whenever it switches, the answers stay
+// right.
+TEST(AdaptiveVowelMatcher, MatchesReference) {
+  const StringCorpus short_corpus = MakeStrings(
+      /*seed=*/5, 3200, ShortStringDistribution, kUniformVowelProbability);
+  const StringCorpus long_corpus =
+      MakeStrings(/*seed=*/6, 3200, LongStringDistribution, 0.0005);
+  const StringCorpus* phases[] = {&short_corpus, &long_corpus, &short_corpus};
+  AdaptiveVowelMatcher matcher;
+  for (const StringCorpus* corpus : phases) {
+    for (std::string_view s : *corpus) {
+      ASSERT_EQ(matcher.HasVowel(s), HasVowelReference(s))
+          << VowelStrategyName(matcher.strategy());
+    }
+    const std::vector<std::string_view> haystacks(corpus->begin(),
+                                                  corpus->end());
+    std::vector<uint64_t> bits(BitVectorWords(64));
+    for (size_t begin = 0; begin + 64 <= haystacks.size(); begin += 64) {
+      const VowelStrategy strategy = matcher.batch_strategy();
+      matcher.HasVowelBatch(std::span(haystacks).subspan(begin, 64), bits);
+      for (size_t i = 0; i < 64; ++i) {
+        ASSERT_EQ((bits[0] >> i) & 1, HasVowelReference(haystacks[begin + i]))
+            << VowelStrategyName(strategy);
+      }
+    }
+  }
+
+  const AdaptiveVowelMatcher::Stats& stats = matcher.stats();
+  uint64_t strings = 0;
+  for (uint64_t n : stats.strings) strings += n;
+  EXPECT_EQ(strings, 2 * 3 * 3200);
+  // The short strings come back, so the input changes at least twice.
+  EXPECT_GE(stats.trials, 2);
+  EXPECT_LE(stats.switches, stats.trials);
+}
+
+// Random appends and overwrites, mostly without vowels, checked after each
+// against the same edits to a plain string.
+TEST(IncrementalStrings, MatchReference) {
+  std::mt19937 rng(8);
+  std::uniform_int_distribution<> length_dist(0, 300);
+  std::bernoulli_distribution is_replace(0.3);
+  VowelChunkedString chunked;
+  VowelSegmentTree tree;
+  std::string reference;
+  for (int step = 0; step < 2000; ++step) {
+    const StringCorpus edit = MakeStrings(
+        step, 1, FixedLengthDistribution(length_dist(rng)), 0.0005);
+    if (is_replace(rng) && edit[0].size() <= reference.size()) {
+      const size_t pos = std::uniform_int_distribution<size_t>(
+          0, reference.size() - edit[0].size())(rng);
+      reference.replace(pos, edit[0].size(), edit[0]);
+      chunked.Replace(pos, edit[0]);
+      tree.Replace(pos, edit[0]);
+    } else {
+      reference += edit[0];
+      chunked.Append(edit[0]);
+      tree.Append(edit[0]);
+    }
+    ASSERT_EQ(chunked.size(), reference.size());
+    ASSERT_EQ(chunked.HasAny(), HasVowelReference(reference)) << step;
+    ASSERT_EQ(tree.HasAny(), HasVowelReference(reference)) << step;
+    std::uniform_int_distribution<size_t> pos_dist(0, reference.size());
+    for (int query = 0; query < 10; ++query) {
+      const size_t begin = pos_dist(rng);
+      const size_t end = std::max(begin, pos_dist(rng));
+      ASSERT_EQ(tree.AnyIn(begin, end),
+                HasVowelReference(
+                    std::string_view(reference).substr(begin, end - begin)))
+          << begin << " " << end;
+    }
+  }
+}
+
+int reference_calls = 0;
+
+bool CountingHasVowelReference(std::string_view haystack) {
+  ++reference_calls;
+  return HasVowelReference(haystack);
+}
+
+TEST(ResultCache, HitsSkipTheKernel) {
+  ResultCache cache(CountingHasVowelReference, 64);
+  reference_calls = 0;
+  const std::string long_key(ResultCache::kMaxKeyBytes + 1, 'x');
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_TRUE(cache.Get("bcdE"));
+    EXPECT_FALSE(cache.Get("bcd"));
+    EXPECT_FALSE(cache.Get(""));
+    EXPECT_FALSE(cache.Get(long_key));
+  }
+  // Each short key once, the long one every time.
+  EXPECT_EQ(reference_calls, 3 + 3);
+  EXPECT_EQ(cache.Lookup("bcd"), false);
+  EXPECT_EQ(cache.Lookup("bcdf"), std::nullopt);
+}
+
+// A table much smaller than the keys, so that slots are overwritten all the
+// time, read and written by several threads at once.
+TEST(ResultCache, ConcurrentGetsMatchReference) {
+  const StringCorpus corpus =
+      MakeZipfStrings(/*seed=*/9, 20'000, 2'000, 1.0, ShortStringDistribution,
+                      kUniformVowelProbability / 4);
+  ResultCache cache(HasVowelReference, 256);
+  std::atomic<int> wrong = 0;
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&] {
+      for (std::string_view s : corpus) {
+        wrong += cache.Get(s) != HasVowelReference(s);
+      }
+    });
+  }
+  for (std::thread& thread : threads) thread.join();
+  EXPECT_EQ(wrong, 0);
+}
+
+// Any codepoint of kUtf8VowelSet, found as its bytes.
+bool HasUtf8VowelReference(std::string_view haystack) {
+  for (std::string_view vowel : Utf8Codepoints(kUtf8VowelSet.view())) {
+    if (haystack.find(vowel) != std::string_view::npos) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Every length up to a few AsciiPrefix blocks, ASCII or not, with an accented
+// vowel at every position, so split across every block and DFA run boundary.
+TEST(HasVowelUtf8, EdgeCases) {
+  std::vector<std::string> cases;
+  for (size_t length = 0; length <= 130; ++length) {
+    for (std::string_view fill : {"x", "\xd0\xb1"}) {  // б
+      std::string s;
+      while (s.size() + fill.size() <= length) s += fill;
+      s.resize(length, 'x');
+      cases.push_back(s);
+      for (size_t i = 0; i + 1 < length; ++i) {
+        for (std::string_view vowel : {"a", "\xc3\xa9"}) {  // é
+          std::string t = s;
+          t.replace(i, vowel.size(), vowel);
+          cases.push_back(t);
+        }
+      }
+    }
+  }
+  // Lead and continuation bytes of accented vowels, on their own and out of
+  // order, and a codepoint that shares the lead byte of é but is no vowel.
+  cases.emplace_back(std::string(70, '\xc3'));
+  cases.emplace_back(std::string(70, '\xa9'));
+  cases.emplace_back(std::string(65, 'x') + "\xa9\xc3");
+  cases.emplace_back(std::string(65, 'x') + "\xc3\xa7");  // ç
+  cases.emplace_back("\xc3\xc3\xa9");
+  for (const std::string& s : cases) {
+    EXPECT_EQ(HasVowelUtf8(s), HasUtf8VowelReference(s)) << s;
+    EXPECT_EQ(HasVowelUtf8Dfa(s), HasUtf8VowelReference(s)) << s;
+  }
+}
+
+TEST(HasVowelUtf8, Corpus) {
+  for (double non_ascii : {0.0, 0.05, 0.9}) {
+    const StringCorpus corpus = MakeUtf8Strings(
+        /*seed=*/7, 200, LongStringDistribution, non_ascii, 0.0005);
+    for (std::string_view s : corpus) {
+      EXPECT_EQ(HasVowelUtf8(s), HasUtf8VowelReference(s)) << non_ascii;
+      EXPECT_EQ(HasVowelUtf8Dfa(s), HasUtf8VowelReference(s)) << non_ascii;
+    }
+  }
+}
+
+}  // namespace
+}  // namespace charscan